@@ -5,18 +5,33 @@
 #include <linux/kthread.h>
 #include <linux/delay.h>
 
+#include "bbb_gpio.h"
+#include "bbb_timing.h"
+
+#define LED_ON_MS 250
+
 static struct gpio_desc *led[4];
 static struct task_struct *blink_thread;
+static struct bbb_gpio_bus leds;
+static struct bbb_timing_stat led_on;
 
+/* Absolute deadlines, so the pattern period does not stretch by the loop's own run time */
 static int blink_fn(void *data)
 {
+    ktime_t next = ktime_get();
+    u64 t0;
     int i;
 
     while (!kthread_should_stop()) {
-        for (i = 0; i < ARRAY_SIZE(led); i++) {
-            gpiod_set_value(led[i], 1);
-            msleep(250);
-            gpiod_set_value(led[i], 0);
+        for (i = 0; i < ARRAY_SIZE(led) && !kthread_should_stop(); i++) {
+            bbb_gpio_bus_set_line(&leds, i, 1);
+            t0 = bbb_timing_now();
+            next = ktime_add_ms(next, LED_ON_MS);
+            bbb_sleep_until(next);
+            bbb_gpio_bus_set_line(&leds, i, 0);
+            if (!kthread_should_stop()) {
+                bbb_timing_stat_record(&led_on, bbb_timing_now() - t0);
+            }
         }
     }
     return 0;
@@ -24,7 +39,7 @@ static int blink_fn(void *data)
 
 static int myleds_probe(struct platform_device *pdev)
 {
-    int i;
+    int i, ret;
 
     for (i = 0; i < ARRAY_SIZE(led); i++) {
 	led[i] = devm_gpiod_get_index(&pdev->dev, NULL, i, GPIOD_OUT_LOW);
@@ -34,8 +49,16 @@ static int myleds_probe(struct platform_device *pdev)
         }
     }
 
+    ret = devm_bbb_gpio_bus_init(&pdev->dev, &leds, led, ARRAY_SIZE(led));
+    if (ret) {
+        return ret;
+    }
+
+    bbb_timing_stat_add(&led_on, "onboard_led_on", LED_ON_MS * NSEC_PER_MSEC);
+
     blink_thread = kthread_run(blink_fn, NULL, "onboard_led_pattern");
     if (IS_ERR(blink_thread)) {
+        bbb_timing_stat_del(&led_on);
         return PTR_ERR(blink_thread);
     }
 
@@ -45,15 +68,12 @@ static int myleds_probe(struct platform_device *pdev)
 
 static void myleds_remove(struct platform_device *pdev)
 {
-    int i;
-
     if (blink_thread) {
         kthread_stop(blink_thread);
     }
+    bbb_timing_stat_del(&led_on);
 
-    for (i = 0; i < ARRAY_SIZE(led); i++) {
-        gpiod_set_value(led[i], 0);
-    }
+    bbb_gpio_bus_set(&leds, 0, GENMASK(ARRAY_SIZE(led) - 1, 0));
 
     dev_info(&pdev->dev, "myleds driver removed\n");
 }
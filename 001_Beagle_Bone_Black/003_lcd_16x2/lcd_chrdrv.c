@@ -7,14 +7,23 @@
 #include <linux/device.h>
 #include <linux/delay.h>
 
+#include "bbb_gpio.h"
+#include "bbb_timing.h"
+
+#define LCD_MAX_ROWS 4
+#define LCD_MAX_COLS 40
+
 typedef struct {
     struct gpio_desc *rs;
     struct gpio_desc *en;
-    struct gpio_desc *d4;
-    struct gpio_desc *d5;
-    struct gpio_desc *d6;
-    struct gpio_desc *d7;
+    struct gpio_desc *en2;
+    struct gpio_desc *data[8];
+    unsigned int bus_width;
+    unsigned int rows;
+    unsigned int cols;
+    u8 row_offsets[LCD_MAX_ROWS];
     struct device *dev;
+    struct bbb_gpio_bus bus;
 } lcd16x2;
 
 extern lcd16x2 *gp_lcd;
@@ -22,90 +31,147 @@ extern lcd16x2 *gp_lcd;
 int lcd_chrdev_register(void);
 void lcd_chrdev_unregister(void);
 
-#define RS(x) gpiod_set_value(gp_lcd->rs, x)
-#define EN(x) gpiod_set_value(gp_lcd->en, x)
-#define D4(x) gpiod_set_value(gp_lcd->d4, x)
-#define D5(x) gpiod_set_value(gp_lcd->d5, x)
-#define D6(x) gpiod_set_value(gp_lcd->d6, x)
-#define D7(x) gpiod_set_value(gp_lcd->d7, x)
+/* Bus order set up by lcd_pltdrv.c: RS, EN, the data lines, then EN2 if any */
+enum { LCD_RS, LCD_EN, LCD_DATA };
+
+#define RS(x) bbb_gpio_bus_set_line(&gp_lcd->bus, LCD_RS, x)
+
+/*
+ * HD44780U minimums for VCC 2.7-4.5 V. The datasheet gives execution
+ * times at the typical 270 kHz, but the RC oscillator may run as slow as
+ * 190 kHz, so they are scaled by 270/190 and rounded up.
+ */
+#define LCD_T_AS_NS     60      /* tAS, RS/data setup before EN rises */
+#define LCD_T_PW_NS     450     /* PWEH, EN high width */
+#define LCD_T_CYC_NS    1000    /* tcycE, EN cycle time */
+#define LCD_T_EXEC_NS   53000   /* 37 us for most instructions and data writes */
+#define LCD_T_HOME_US   2200    /* 1.52 ms for clear display and return home */
+
+static struct bbb_timing_stat lcd_en_stat;
+
+/* 40x4 panels are two controllers sharing the bus, EN2 drives rows 2-3 */
+static unsigned int lcd_ctrl;
+
+static unsigned int lcd_num_ctrl(void)
+{
+    return gp_lcd->en2 ? 2 : 1;
+}
 
 static void lcd_enable_pulse(void)
 {
-    EN(1);
-    mdelay(1);
-    EN(0);
-    mdelay(2);
+    unsigned int en = lcd_ctrl ? LCD_DATA + gp_lcd->bus_width : LCD_EN;
+
+    bbb_ndelay(LCD_T_AS_NS);
+    bbb_gpio_pulse(&gp_lcd->bus, en, &lcd_en_stat);
+    bbb_ndelay(LCD_T_CYC_NS - LCD_T_PW_NS);
 }
 
-static void lcd_write_char(uint8_t value)
+/* All data lines change together, one store per bank when the fast path is on */
+static void lcd_write_bus(uint8_t value)
 {
-    D4((value >> 4) & 0x01);
-    D5((value >> 5) & 0x01);
-    D6((value >> 6) & 0x01);
-    D7((value >> 7) & 0x01);
-    lcd_enable_pulse();
+    unsigned long mask = GENMASK(gp_lcd->bus_width - 1, 0);
 
-    D4((value >> 0) & 0x01);
-    D5((value >> 1) & 0x01);
-    D6((value >> 2) & 0x01);
-    D7((value >> 3) & 0x01);
+    bbb_gpio_bus_set(&gp_lcd->bus, (value & mask) << LCD_DATA, mask << LCD_DATA);
     lcd_enable_pulse();
 }
 
+/* One enable pulse per byte on an 8-bit bus, two on a 4-bit one */
+static void lcd_write_char(uint8_t value)
+{
+    if (gp_lcd->bus_width == 8) {
+        lcd_write_bus(value);
+        return;
+    }
+    lcd_write_bus(value >> 4);
+    lcd_write_bus(value & 0x0F);
+}
+
 static void lcd_command(uint8_t value)
 {
     printk(KERN_DEBUG "lcd16x2: Sending command 0x%02X\n", value);
     RS(0);
     lcd_write_char(value);
+
+    if (value == 0x01 || (value & 0xFE) == 0x02)
+        usleep_range(LCD_T_HOME_US, LCD_T_HOME_US + 200);
+    else
+        bbb_ndelay(LCD_T_EXEC_NS);
+}
+
+/* Instructions that set up the whole panel go to every controller */
+static void lcd_command_all(uint8_t value)
+{
+    for (lcd_ctrl = 0; lcd_ctrl < lcd_num_ctrl(); lcd_ctrl++)
+        lcd_command(value);
+    lcd_ctrl = 0;
 }
 
 static void lcd_write_8bit(uint8_t value)
 {
     RS(1);
     lcd_write_char(value);
+    bbb_ndelay(LCD_T_EXEC_NS);
 }
 
 static void lcd_set_cursor(uint8_t col, uint8_t row)
 {
-    uint8_t row_offsets[] = {0x00, 0x40};
-    lcd_command(0x80 | (col + row_offsets[row]));
+    lcd_ctrl = row / (gp_lcd->rows / lcd_num_ctrl());
+    lcd_command(0x80 | (col + gp_lcd->row_offsets[row]));
 }
 
 static void lcd_send_string(char *msg)
 {
-    uint8_t i = 0;
-
-    while (msg[i] != '\0')
-    {
-		if (i >= 32) {
-			break;
-		}
-		else if (i == 16) {
-			lcd_set_cursor(0, 1);
-		}
-		else {
-			pr_info("%c", msg[i]);
-		}
-
-		lcd_write_8bit((uint8_t) msg[i++]);
+    unsigned int i;
+
+    for (i = 0; msg[i] != '\0' && i < gp_lcd->rows * gp_lcd->cols; i++) {
+        if (i && i % gp_lcd->cols == 0)
+            lcd_set_cursor(0, i / gp_lcd->cols);
+        lcd_write_8bit((uint8_t) msg[i]);
     }
-	pr_info("\n");
 }
 
 static void lcd_clear(void)
 {
-    lcd_command(0x01);
+    lcd_command_all(0x01);
 }
 
 static void lcd_init(void)
 {
-    printk(KERN_INFO "lcd16x2: Initializing LCD\n");
+    /* DL for the bus width, N for two-line mode unless each controller has one row */
+    uint8_t function = (gp_lcd->bus_width == 8 ? 0x30 : 0x20) |
+                       (gp_lcd->rows / lcd_num_ctrl() > 1 ? 0x08 : 0x00);
+
+    printk(KERN_INFO "lcd16x2: Initializing %ux%u LCD, %u-bit bus\n",
+           gp_lcd->cols, gp_lcd->rows, gp_lcd->bus_width);
     msleep(15);
-    lcd_command(0x02);
-    lcd_command(0x28);
-    lcd_command(0x0C);
-    lcd_command(0x01);
-    lcd_command(0x06);
+
+    /*
+     * Reset by instruction. The controller may still be in 8-bit mode, where
+     * every nibble is a full instruction, so the nibbles need their own
+     * execution waits before 4-bit mode is entered. On an 8-bit bus the same
+     * writes carry 0x30 and the final one is skipped.
+     */
+    RS(0);
+    for (lcd_ctrl = 0; lcd_ctrl < lcd_num_ctrl(); lcd_ctrl++) {
+        uint8_t reset = (gp_lcd->bus_width == 8) ? 0x30 : 0x03;
+
+        lcd_write_bus(reset);
+        usleep_range(4100, 4500);
+        lcd_write_bus(reset);
+        udelay(100);
+        lcd_write_bus(reset);
+        bbb_ndelay(LCD_T_EXEC_NS);
+        if (gp_lcd->bus_width == 4) {
+            lcd_write_bus(0x02);
+            bbb_ndelay(LCD_T_EXEC_NS);
+        }
+    }
+    lcd_ctrl = 0;
+
+    lcd_command_all(function);
+    lcd_command_all(0x0C);
+    lcd_command_all(0x01);
+    lcd_command_all(0x06);
     lcd_command(0x80);
     printk(KERN_INFO "lcd16x2: LCD initialization complete\n");
 }
@@ -113,7 +179,7 @@ static void lcd_init(void)
 static ssize_t lcd_write(struct file *file, const char __user *buf, size_t len, loff_t *ppos)
 {
 	static int pos;
-    static char kbuf[33];
+    static char kbuf[LCD_MAX_ROWS * LCD_MAX_COLS + 1];
     size_t clen;
 
     if (!gp_lcd)
@@ -165,6 +231,9 @@ int lcd_chrdev_register(void)
 		return -ENODEV;
 	}
 	
+	bbb_timing_stat_add(&lcd_en_stat, "lcd16x2_en", LCD_T_PW_NS);
+	bbb_timing_measure_bus(&gp_lcd->bus, dev_name(gp_lcd->dev));
+
 	lcd_init();	
 	lcd_clear();
     lcd_set_cursor(0, 0);	
@@ -178,6 +247,7 @@ int lcd_chrdev_register(void)
 void lcd_chrdev_unregister(void)
 {
     misc_deregister(&lcd_dev);
+    bbb_timing_stat_del(&lcd_en_stat);
     pr_info("lcd16x2_chardev unloaded\n");
 }
 
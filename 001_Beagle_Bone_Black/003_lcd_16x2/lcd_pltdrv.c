@@ -3,26 +3,122 @@
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
+#include <linux/property.h>
 #include <linux/gpio/consumer.h>
 
+#include "bbb_gpio.h"
+
 extern int lcd_chrdev_register(void);
 extern void lcd_chrdev_unregister(void);
 
+#define LCD_MAX_ROWS 4
+#define LCD_MAX_COLS 40
+
 typedef struct {
     struct gpio_desc *rs;
     struct gpio_desc *en;
-    struct gpio_desc *d4;
-    struct gpio_desc *d5;
-    struct gpio_desc *d6;
-    struct gpio_desc *d7;
+    struct gpio_desc *en2;
+    struct gpio_desc *data[8];
+    unsigned int bus_width;
+    unsigned int rows;
+    unsigned int cols;
+    u8 row_offsets[LCD_MAX_ROWS];
 	struct device *dev;
+    struct bbb_gpio_bus bus;
 }lcd16x2;
 
 lcd16x2 *gp_lcd;
 EXPORT_SYMBOL(gp_lcd);
 
+/*
+ * data-gpios lists D0-D7 for an 8-bit bus or D4-D7 for a 4-bit one. Older
+ * overlays name the four lines d4-gpios..d7-gpios, which still works.
+ */
+static int lcd16x2_get_data(struct device *dev, lcd16x2 *lcd)
+{
+    static const char * const legacy[] = { "d4", "d5", "d6", "d7" };
+    struct gpio_descs *data;
+    unsigned int i;
+
+    data = devm_gpiod_get_array_optional(dev, "data", GPIOD_OUT_LOW);
+    if (IS_ERR(data))
+        return PTR_ERR(data);
+
+    if (data) {
+        if (data->ndescs != 4 && data->ndescs != 8) {
+            dev_err(dev, "data-gpios needs 4 or 8 lines, got %u\n", data->ndescs);
+            return -EINVAL;
+        }
+        lcd->bus_width = data->ndescs;
+        for (i = 0; i < data->ndescs; i++)
+            lcd->data[i] = data->desc[i];
+        return 0;
+    }
+
+    lcd->bus_width = 4;
+    for (i = 0; i < ARRAY_SIZE(legacy); i++) {
+        lcd->data[i] = devm_gpiod_get(dev, legacy[i], GPIOD_OUT_LOW);
+        if (IS_ERR(lcd->data[i]))
+            return PTR_ERR(lcd->data[i]);
+    }
+    return 0;
+}
+
+/*
+ * display-height-chars/display-width-chars default to 16x2. Row start
+ * addresses default to 0x00, 0x40, cols, 0x40 + cols, which is right for
+ * 16x4 and 20x4; with en2-gpios each controller gets 0x00, 0x40.
+ * anis,row-offsets overrides them for odd panels.
+ */
+static int lcd16x2_get_geometry(struct device *dev, lcd16x2 *lcd)
+{
+    u32 offsets[LCD_MAX_ROWS];
+    unsigned int ctrl_rows, i;
+
+    lcd->rows = 2;
+    lcd->cols = 16;
+    device_property_read_u32(dev, "display-height-chars", &lcd->rows);
+    device_property_read_u32(dev, "display-width-chars", &lcd->cols);
+
+    if (!lcd->rows || lcd->rows > LCD_MAX_ROWS || !lcd->cols || lcd->cols > LCD_MAX_COLS ||
+        (lcd->en2 && lcd->rows % 2)) {
+        dev_err(dev, "unsupported geometry %ux%u\n", lcd->cols, lcd->rows);
+        return -EINVAL;
+    }
+
+    /* In two-line mode each line is 40 characters of DDRAM */
+    ctrl_rows = lcd->en2 ? lcd->rows / 2 : lcd->rows;
+    if (ctrl_rows > 2 && lcd->cols > LCD_MAX_COLS / 2) {
+        dev_err(dev, "%ux%u needs two controllers (en2-gpios)\n", lcd->cols, lcd->rows);
+        return -EINVAL;
+    }
+
+    for (i = 0; i < lcd->rows; i++)
+        offsets[i] = ((i % ctrl_rows) & 1 ? 0x40 : 0x00) + ((i % ctrl_rows) / 2) * lcd->cols;
+
+    if (device_property_present(dev, "anis,row-offsets") &&
+        device_property_read_u32_array(dev, "anis,row-offsets", offsets, lcd->rows)) {
+        dev_err(dev, "anis,row-offsets needs %u entries\n", lcd->rows);
+        return -EINVAL;
+    }
+
+    /* DDRAM is 0x00-0x4F in one-line mode, 0x00-0x27 and 0x40-0x67 in two-line mode */
+    for (i = 0; i < lcd->rows; i++) {
+        u32 end = (ctrl_rows == 1) ? 0x50 : (offsets[i] < 0x40 ? 0x28 : 0x68);
+
+        if (offsets[i] + lcd->cols > end) {
+            dev_err(dev, "row %u offset 0x%02x out of DDRAM\n", i, offsets[i]);
+            return -EINVAL;
+        }
+        lcd->row_offsets[i] = offsets[i];
+    }
+    return 0;
+}
+
 static int lcd16x2_probe(struct platform_device *pdev)
 {
+    struct gpio_desc *lines[2 + 8 + 1];
+    unsigned int i, n = 0;
 	int ret;
 
     gp_lcd = devm_kzalloc(&pdev->dev, sizeof(lcd16x2), GFP_KERNEL);
@@ -32,23 +128,41 @@ static int lcd16x2_probe(struct platform_device *pdev)
 
     gp_lcd->rs = devm_gpiod_get(&pdev->dev, "rs", GPIOD_OUT_LOW);
     gp_lcd->en = devm_gpiod_get(&pdev->dev, "en", GPIOD_OUT_LOW);
-    gp_lcd->d4 = devm_gpiod_get(&pdev->dev, "d4", GPIOD_OUT_LOW);
-    gp_lcd->d5 = devm_gpiod_get(&pdev->dev, "d5", GPIOD_OUT_LOW);
-    gp_lcd->d6 = devm_gpiod_get(&pdev->dev, "d6", GPIOD_OUT_LOW);
-    gp_lcd->d7 = devm_gpiod_get(&pdev->dev, "d7", GPIOD_OUT_LOW);
-
-    if (IS_ERR(gp_lcd->rs) || IS_ERR(gp_lcd->en) || 
-		IS_ERR(gp_lcd->d4) || IS_ERR(gp_lcd->d5) || 
-		IS_ERR(gp_lcd->d6) || IS_ERR(gp_lcd->d7))
+    gp_lcd->en2 = devm_gpiod_get_optional(&pdev->dev, "en2", GPIOD_OUT_LOW);
+
+    if (IS_ERR(gp_lcd->rs) || IS_ERR(gp_lcd->en) || IS_ERR(gp_lcd->en2))
 	{
         dev_err(&pdev->dev, "Failed to get GPIOs\n");
         return -EINVAL;
     }
-	
+
+    ret = lcd16x2_get_data(&pdev->dev, gp_lcd);
+    if (ret) {
+        dev_err(&pdev->dev, "Failed to get data GPIOs\n");
+        return ret;
+    }
+
+    ret = lcd16x2_get_geometry(&pdev->dev, gp_lcd);
+    if (ret)
+        return ret;
+
+	/* Bus order is the line index used by lcd_chrdrv.c: RS, EN, data, EN2 */
+    lines[n++] = gp_lcd->rs;
+    lines[n++] = gp_lcd->en;
+    for (i = 0; i < gp_lcd->bus_width; i++)
+        lines[n++] = gp_lcd->data[i];
+    if (gp_lcd->en2)
+        lines[n++] = gp_lcd->en2;
+
+    ret = devm_bbb_gpio_bus_init(&pdev->dev, &gp_lcd->bus, lines, n);
+    if (ret)
+        return ret;
+
 	gp_lcd->dev = &pdev->dev;
 	platform_set_drvdata(pdev, gp_lcd);
 	
-    dev_info(&pdev->dev, "%s: lcd16x2 driver probed\n", __func__);	
+    dev_info(&pdev->dev, "%s: lcd16x2 driver probed, %ux%u on a %u-bit bus\n", __func__,
+             gp_lcd->cols, gp_lcd->rows, gp_lcd->bus_width);	
 	
 	ret = lcd_chrdev_register(); 
 	if (ret) { 
@@ -8,8 +8,11 @@
 #include <linux/of_irq.h>
 #include <linux/delay.h>
 
+#include "bbb_gpio.h"
+
 static struct gpio_desc *led[4];
 static struct gpio_desc *btn;
+static struct bbb_gpio_bus leds;
 static int irq_num, irq_cnt;
 
 static irqreturn_t button_irq_handler(int irq, void *dev_id)
@@ -21,10 +24,7 @@ static irqreturn_t button_irq_thread(int irq, void *dev_id)
 {
     irq_cnt++;
     irq_cnt %= 16;
-    gpiod_set_value(led[0], (irq_cnt & 0b0001) ? 1 : 0);
-    gpiod_set_value(led[1], (irq_cnt & 0b0010) ? 1 : 0);
-    gpiod_set_value(led[2], (irq_cnt & 0b0100) ? 1 : 0);
-    gpiod_set_value(led[3], (irq_cnt & 0b1000) ? 1 : 0);
+    bbb_gpio_bus_set(&leds, irq_cnt, 0b1111);
     pr_info("Button IRQ (threaded): LEDs toggled to %d\n", irq_cnt);
     return IRQ_HANDLED;
 }
@@ -43,6 +43,12 @@ static int btn_led_probe(struct platform_device *pdev)
         }
     }
 
+    ret = devm_bbb_gpio_bus_init(&pdev->dev, &leds, led, ARRAY_SIZE(led));
+    if (ret)
+    {
+        return ret;
+    }
+
     btn = devm_gpiod_get(&pdev->dev, "btn", GPIOD_IN);
     if (IS_ERR(btn)) 
     {
@@ -70,11 +76,7 @@ static int btn_led_probe(struct platform_device *pdev)
 
 static void btn_led_remove(struct platform_device *pdev)
 {
-    int i;
-    for (i = 0; i < ARRAY_SIZE(led); i++) 
-    {
-        gpiod_set_value(led[i], 0);
-    }
+    bbb_gpio_bus_set(&leds, 0, 0b1111);
     dev_info(&pdev->dev, "Button IRQ driver removed\n");
 }
 
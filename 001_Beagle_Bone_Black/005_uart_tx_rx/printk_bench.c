@@ -0,0 +1,166 @@
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+
+#define BENCH_MAX_LEN 256
+
+/*
+ * printk storm benchmark for the serial console, under
+ * /sys/kernel/debug/printk_bench/. Writing anything to "run" issues "count"
+ * pr_info() calls of "len" characters from this CPU while a pinned hardirq
+ * hrtimer ticks every "period_us". How late that timer fires is the
+ * interrupts-off time the console imposed on the printing CPU; the per-call
+ * cost is what printk() callers such as IRQ threads see. Run it once with
+ * the legacy console and once with the nbcon one and compare "results".
+ */
+static struct dentry *bench_dir;
+static DEFINE_MUTEX(bench_lock);
+static u32 bench_count = 1000;
+static u32 bench_len = 80;
+static u32 bench_period_us = 100;
+
+struct bench_result
+{
+    u32 count;
+    u32 len;
+    u64 elapsed_ns;
+    u64 call_ns;
+    u64 call_ns_max;
+    u64 ticks;
+    u64 late_ns;
+    u64 late_ns_max;
+    int cpu;
+};
+
+static struct bench_result bench_result;
+static struct hrtimer bench_timer;
+static ktime_t bench_period;
+
+static enum hrtimer_restart bench_tick(struct hrtimer *t)
+{
+    u64 late = ktime_to_ns(ktime_sub(ktime_get(), hrtimer_get_expires(t)));
+
+    bench_result.ticks++;
+    bench_result.late_ns += late;
+    bench_result.late_ns_max = max(bench_result.late_ns_max, late);
+
+    hrtimer_forward_now(t, bench_period);
+    return HRTIMER_RESTART;
+}
+
+static int bench_run(void)
+{
+    static char pad[BENCH_MAX_LEN + 1];
+    struct bench_result *res = &bench_result;
+    u32 count = READ_ONCE(bench_count);
+    u32 len = READ_ONCE(bench_len);
+    u32 period_us = READ_ONCE(bench_period_us);
+    u64 start, t0, dt;
+    u32 i;
+
+    if (!count || len > BENCH_MAX_LEN || !period_us)
+        return -EINVAL;
+
+    memset(pad, 'x', len);
+    pad[len] = '\0';
+    memset(res, 0, sizeof(*res));
+    res->count = count;
+    res->len = len;
+
+    /* The probe timer has to share the CPU that does the printing */
+    migrate_disable();
+    res->cpu = raw_smp_processor_id();
+
+    bench_period = us_to_ktime(period_us);
+    hrtimer_start(&bench_timer, bench_period, HRTIMER_MODE_REL_PINNED_HARD);
+
+    start = ktime_get_ns();
+    for (i = 0; i < count; i++)
+    {
+        t0 = ktime_get_ns();
+        pr_info("printk_bench %u %s\n", i, pad);
+        dt = ktime_get_ns() - t0;
+
+        res->call_ns += dt;
+        res->call_ns_max = max(res->call_ns_max, dt);
+    }
+    res->elapsed_ns = ktime_get_ns() - start;
+
+    hrtimer_cancel(&bench_timer);
+    migrate_enable();
+
+    pr_info("printk_bench: %u x %u chars in %llu us, worst call %llu ns, worst timer delay %llu ns\n",
+            count, len, div_u64(res->elapsed_ns, NSEC_PER_USEC), res->call_ns_max, res->late_ns_max);
+    return 0;
+}
+
+static ssize_t bench_run_write(struct file *file, const char __user *buf,
+                               size_t len, loff_t *ppos)
+{
+    int ret;
+
+    mutex_lock(&bench_lock);
+    ret = bench_run();
+    mutex_unlock(&bench_lock);
+
+    return ret ? ret : len;
+}
+
+static const struct file_operations bench_run_fops = {
+    .owner = THIS_MODULE,
+    .write = bench_run_write,
+};
+
+static int bench_results_show(struct seq_file *s, void *unused)
+{
+    const struct bench_result *res = &bench_result;
+
+    mutex_lock(&bench_lock);
+    seq_printf(s, "cpu          %d\n", res->cpu);
+    seq_printf(s, "messages     %u x %u chars\n", res->count, res->len);
+    seq_printf(s, "elapsed_us   %llu\n", div_u64(res->elapsed_ns, NSEC_PER_USEC));
+    seq_printf(s, "msgs_per_sec %llu\n",
+               res->elapsed_ns ? div64_u64((u64)res->count * NSEC_PER_SEC, res->elapsed_ns) : 0);
+    seq_printf(s, "call_ns_avg  %llu\n", res->count ? div_u64(res->call_ns, res->count) : 0);
+    seq_printf(s, "call_ns_max  %llu\n", res->call_ns_max);
+    seq_printf(s, "ticks        %llu\n", res->ticks);
+    seq_printf(s, "late_ns_avg  %llu\n", res->ticks ? div64_u64(res->late_ns, res->ticks) : 0);
+    seq_printf(s, "late_ns_max  %llu\n", res->late_ns_max);
+    mutex_unlock(&bench_lock);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bench_results);
+
+static int __init printk_bench_init(void)
+{
+    hrtimer_setup(&bench_timer, bench_tick, CLOCK_MONOTONIC, HRTIMER_MODE_REL_PINNED_HARD);
+
+    bench_dir = debugfs_create_dir("printk_bench", NULL);
+    debugfs_create_u32("count", 0644, bench_dir, &bench_count);
+    debugfs_create_u32("len", 0644, bench_dir, &bench_len);
+    debugfs_create_u32("period_us", 0644, bench_dir, &bench_period_us);
+    debugfs_create_file("run", 0200, bench_dir, NULL, &bench_run_fops);
+    debugfs_create_file("results", 0444, bench_dir, NULL, &bench_results_fops);
+
+    pr_info("printk_bench loaded\n");
+    return 0;
+}
+
+static void __exit printk_bench_exit(void)
+{
+    debugfs_remove_recursive(bench_dir);
+    pr_info("printk_bench unloaded\n");
+}
+
+module_init(printk_bench_init);
+module_exit(printk_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Anis");
+MODULE_DESCRIPTION("printk throughput and interrupts-off benchmark for the serial console");
@@ -1,42 +1,237 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 
-int main() 
+#include "uart_lib.h"
+#include "uart_frame.h"
+
+#define UART_DEVICE "/dev/ttyS2"
+#define UART_BAUD 115200
+#define RX_TIMEOUT_MS 2000
+#define TELEMETRY_FRAMES 16
+
+struct uart_app
 {
-    int uart_fd;
-    char send_buffer[64] = "Hello from Linux!";
+    struct uart_loop loop;
+    struct uart_port uart;
+    struct uart_port peer;
     char receive_buffer[64];
-    ssize_t bytes_written, bytes_read;
+    size_t bytes_read;
+    size_t bytes_expected;
+    struct frame_decoder decoder;
+    unsigned int frames_read;
+};
+
+static void uart_on_rx(struct uart_port *port, void *arg)
+{
+    struct uart_app *app = arg;
 
-    uart_fd = open("/dev/ttyS2", O_RDWR);
-    if (uart_fd < 0) 
+    app->bytes_read += uart_port_read(port, app->receive_buffer + app->bytes_read,
+                                      sizeof(app->receive_buffer) - 1 - app->bytes_read);
+    if (app->bytes_read >= app->bytes_expected)
     {
-        perror("Failed to open UART device");
+        uart_loop_stop(&app->loop);
+    }
+}
+
+static void uart_on_frame(const uint8_t *payload, size_t len, void *arg)
+{
+    struct uart_app *app = arg;
+
+    printf("Frame %u: %.*s\n", app->frames_read++, (int)len, (const char *)payload);
+    if (app->frames_read >= TELEMETRY_FRAMES)
+    {
+        uart_loop_stop(&app->loop);
+    }
+}
+
+/* Framed mode: decode straight out of the RX ring, one chunk per read() */
+static void uart_on_rx_framed(struct uart_port *port, void *arg)
+{
+    struct uart_app *app = arg;
+    uint8_t *data;
+    size_t len;
+
+    while ((len = uart_port_peek(port, &data)) > 0)
+    {
+        frame_decoder_feed(&app->decoder, data, len);
+        uart_port_consume(port, len);
+    }
+}
+
+static size_t build_telemetry_batch(uint8_t *out, size_t out_size)
+{
+    char msg[32];
+    size_t pos = 0;
+    size_t n;
+    int i, len;
+
+    for (i = 0; i < TELEMETRY_FRAMES; i++)
+    {
+        len = snprintf(msg, sizeof(msg), "seq=%d temp=%d", i, 2500 + i * 3);
+        n = frame_encode(msg, len, out + pos, out_size - pos);
+        if (!n)
+        {
+            break;
+        }
+        pos += n;
+    }
+    return pos;
+}
+
+/* pty mode: the master side plays the loopback wire and echoes everything */
+static void peer_on_rx(struct uart_port *port, void *arg)
+{
+    uint8_t *data;
+    size_t len;
+
+    while ((len = uart_port_peek(port, &data)) > 0)
+    {
+        len = uart_port_write(port, data, len);
+        if (!len)
+        {
+            break;
+        }
+        uart_port_consume(port, len);
+    }
+}
+
+static void uart_on_hangup(struct uart_port *port, void *arg)
+{
+    struct uart_app *app = arg;
+
+    fprintf(stderr, "UART %s hung up\n", port->path);
+    uart_loop_stop(&app->loop);
+}
+
+int main(int argc, char *argv[])
+{
+    struct uart_app app;
+    struct uart_config cfg = { .baud = UART_BAUD, .vmin = 0, .vtime = 0 };
+    const char *device = UART_DEVICE;
+    char send_buffer[64] = "Hello from Linux!";
+    size_t bytes_written;
+    struct timespec start, now;
+    uint8_t frame_batch[TELEMETRY_FRAMES * 40];
+    size_t batch_len;
+    int use_pty = 0;
+    int framed = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:b:pf")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            device = optarg;
+            break;
+        case 'b':
+            cfg.baud = strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            use_pty = 1;
+            break;
+        case 'f':
+            framed = 1;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-d device] [-b baud] [-p (pty loopback)] [-f (framed telemetry)]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    memset(&app, 0, sizeof(app));
+    if (uart_loop_init(&app.loop) < 0)
+    {
+        perror("Failed to create event loop");
         return 1;
     }
 
-    bytes_written = write(uart_fd, send_buffer, strlen(send_buffer));
-    if (bytes_written < 0)
+    if (use_pty)
     {
-        perror("Failed to write to UART device");
-        close(uart_fd);
+        if (uart_port_open_pty(&app.peer, &app.uart, &cfg) < 0)
+        {
+            perror("Failed to open pty pair");
+            return 1;
+        }
+        app.peer.on_rx = peer_on_rx;
+        app.peer.on_hangup = uart_on_hangup;
+        app.peer.arg = &app;
+        uart_loop_add(&app.loop, &app.peer);
+    }
+    else if (uart_port_open(&app.uart, device, &cfg) < 0)
+    {
+        perror("Failed to open UART device");
         return 1;
     }
-    printf("Sent %zd bytes: %s\n", bytes_written, send_buffer);
 
-    bytes_read = read(uart_fd, receive_buffer, 64 - 1);
-    if (bytes_read < 0) 
+    app.uart.on_rx = framed ? uart_on_rx_framed : uart_on_rx;
+    app.uart.on_hangup = uart_on_hangup;
+    app.uart.arg = &app;
+    if (uart_loop_add(&app.loop, &app.uart) < 0)
     {
-        perror("Failed to read from UART device");
-        close(uart_fd);
+        perror("Failed to add UART to event loop");
+        uart_port_close(&app.uart);
         return 1;
     }
-    receive_buffer[bytes_read] = '\0';
-    printf("Received %zd bytes: %s\n", bytes_read, receive_buffer);
 
-    close(uart_fd);
-    return 0;
-}
\ No newline at end of file
+    if (framed)
+    {
+        frame_decoder_init(&app.decoder, uart_on_frame, &app);
+        batch_len = build_telemetry_batch(frame_batch, sizeof(frame_batch));
+        bytes_written = uart_port_write(&app.uart, frame_batch, batch_len);
+        printf("Sent %d frames in one %zu byte write\n", TELEMETRY_FRAMES, bytes_written);
+    }
+    else
+    {
+        app.bytes_expected = strlen(send_buffer);
+        bytes_written = uart_port_write(&app.uart, send_buffer, app.bytes_expected);
+        printf("Sent %zu bytes: %s\n", bytes_written, send_buffer);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    app.loop.running = true;
+    while (app.loop.running)
+    {
+        if (uart_loop_run_once(&app.loop, 100) < 0)
+        {
+            perror("Event loop failed");
+            break;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 >= RX_TIMEOUT_MS)
+        {
+            fprintf(stderr, "Timed out waiting for echo\n");
+            break;
+        }
+    }
+
+    if (framed)
+    {
+        printf("Received %u frames (%lu crc errors, %lu cobs errors, %lu overruns)\n",
+               app.frames_read, app.decoder.crc_errors, app.decoder.cobs_errors,
+               app.decoder.overruns);
+    }
+    else
+    {
+        app.receive_buffer[app.bytes_read] = '\0';
+        printf("Received %zu bytes: %s\n", app.bytes_read, app.receive_buffer);
+    }
+
+    uart_port_close(&app.uart);
+    if (use_pty)
+    {
+        uart_port_close(&app.peer);
+    }
+    uart_loop_close(&app.loop);
+    if (framed)
+    {
+        return (app.frames_read == TELEMETRY_FRAMES) ? 0 : 1;
+    }
+    return (app.bytes_read == app.bytes_expected) ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+
+#include "uart_lib.h"
+
+/*
+ * Kept apart from uart_lib.c because <asm/termbits.h> and glibc's
+ * <termios.h> cannot be included in the same translation unit.
+ */
+int uart_set_custom_baud(int fd, unsigned int baud)
+{
+    struct termios2 tio;
+
+    if (ioctl(fd, TCGETS2, &tio) < 0)
+    {
+        return -1;
+    }
+
+    tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    tio.c_ispeed = baud;
+    tio.c_ospeed = baud;
+
+    return ioctl(fd, TCSETS2, &tio);
+}
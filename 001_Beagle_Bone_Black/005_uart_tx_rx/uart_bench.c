@@ -0,0 +1,426 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "uart_lib.h"
+
+#define UART_DEVICE "/dev/ttyS2"
+#define PKT_SIZE 32
+#define PKT_SYNC0 0x55
+#define PKT_SYNC1 0xAA
+#define MAX_PINGS 1000
+#define RX_BUF_SIZE 8192
+
+/* Standard rates up to the 3.6864 Mbaud the AM335x UART reaches in 13x mode */
+static const unsigned int bench_bauds[] = {
+    9600, 19200, 38400, 57600, 115200, 230400, 460800, 500000, 576000,
+    921600, 1000000, 1152000, 1500000, 1843200, 2000000, 2500000,
+    3000000, 3500000, 3686400,
+};
+
+struct bench
+{
+    struct uart_loop loop;
+    struct uart_port uart;
+    struct uart_port peer;
+    int use_pty;
+
+    uint8_t rx_buf[RX_BUF_SIZE];
+    size_t rx_len;
+    uint32_t tx_seq;
+
+    unsigned long tx_bytes;
+    unsigned long rx_bytes;
+    unsigned long good;
+    unsigned long corrupt;
+    unsigned long skipped;
+    uint64_t last_rx_ns;
+    uint32_t last_lat_us;
+    uint32_t ping_seq;
+    int got_pkt;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double cpu_seconds(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+           (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static uint16_t fletcher16(const uint8_t *data, size_t len)
+{
+    uint16_t a = 0, b = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        a = (a + data[i]) % 255;
+        b = (b + a) % 255;
+    }
+    return (b << 8) | a;
+}
+
+/* sync(2) | seq(4) | tx timestamp ns(8) | payload(16) | fletcher16(2) */
+static void pkt_build(uint8_t *pkt, uint32_t seq)
+{
+    uint64_t ts = now_ns();
+    uint16_t sum;
+    int i;
+
+    pkt[0] = PKT_SYNC0;
+    pkt[1] = PKT_SYNC1;
+    memcpy(&pkt[2], &seq, sizeof(seq));
+    memcpy(&pkt[6], &ts, sizeof(ts));
+    for (i = 14; i < 30; i++)
+    {
+        pkt[i] = (uint8_t)((seq + i) * 0x9D);
+    }
+    sum = fletcher16(&pkt[2], 28);
+    pkt[30] = sum & 0xFF;
+    pkt[31] = sum >> 8;
+}
+
+static void bench_parse(struct bench *b)
+{
+    size_t pos = 0;
+
+    while (b->rx_len - pos >= PKT_SIZE)
+    {
+        uint8_t *pkt = &b->rx_buf[pos];
+        uint16_t sum;
+        uint32_t seq;
+        uint64_t ts;
+
+        if (pkt[0] != PKT_SYNC0 || pkt[1] != PKT_SYNC1)
+        {
+            b->skipped++;
+            pos++;
+            continue;
+        }
+
+        sum = pkt[30] | (pkt[31] << 8);
+        if (sum != fletcher16(&pkt[2], 28))
+        {
+            /* Resync one byte later, a real header may be inside this one */
+            b->corrupt++;
+            b->skipped++;
+            pos++;
+            continue;
+        }
+
+        /* A late echo of a ping that already timed out is not this ping's reply */
+        memcpy(&seq, &pkt[2], sizeof(seq));
+        if (seq == b->ping_seq)
+        {
+            memcpy(&ts, &pkt[6], sizeof(ts));
+            b->last_lat_us = (uint32_t)((now_ns() - ts) / 1000);
+            b->got_pkt = 1;
+        }
+        b->good++;
+        pos += PKT_SIZE;
+    }
+
+    memmove(b->rx_buf, &b->rx_buf[pos], b->rx_len - pos);
+    b->rx_len -= pos;
+}
+
+static void bench_on_rx(struct uart_port *port, void *arg)
+{
+    struct bench *b = arg;
+    size_t n;
+
+    while ((n = uart_port_read(port, &b->rx_buf[b->rx_len], RX_BUF_SIZE - b->rx_len)) > 0)
+    {
+        b->rx_len += n;
+        b->rx_bytes += n;
+        bench_parse(b);
+    }
+    b->last_rx_ns = now_ns();
+}
+
+/* pty mode: the master side plays the loopback wire and echoes everything */
+static void peer_on_rx(struct uart_port *port, void *arg)
+{
+    uint8_t *data;
+    size_t len;
+
+    while ((len = uart_port_peek(port, &data)) > 0)
+    {
+        len = uart_port_write(port, data, len);
+        if (!len)
+        {
+            break;
+        }
+        uart_port_consume(port, len);
+    }
+}
+
+static void bench_reset(struct bench *b)
+{
+    uint8_t *data;
+    size_t len;
+
+    while ((len = uart_port_peek(&b->uart, &data)) > 0)
+    {
+        uart_port_consume(&b->uart, len);
+    }
+    b->rx_len = 0;
+    b->tx_bytes = b->rx_bytes = 0;
+    b->good = b->corrupt = b->skipped = 0;
+    b->got_pkt = 0;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Time for @bytes on the wire at 8N1, plus slack for scheduling */
+static int wire_timeout_ms(unsigned int baud, unsigned long bytes)
+{
+    return (int)(bytes * 10 * 1000ULL / baud) + 200;
+}
+
+static int bench_throughput(struct bench *b, unsigned int baud, double secs)
+{
+    unsigned long total_pkts = (unsigned long)(baud / 10 * secs) / PKT_SIZE;
+    uint8_t pkt[PKT_SIZE];
+    uint64_t start, end, idle_ns;
+    double cpu0, cpu1;
+
+    if (!total_pkts)
+    {
+        total_pkts = 1;
+    }
+    idle_ns = (uint64_t)wire_timeout_ms(baud, 4 * PKT_SIZE) * 1000000ULL;
+
+    bench_reset(b);
+    b->tx_seq = 0;
+    cpu0 = cpu_seconds();
+    start = now_ns();
+    b->last_rx_ns = start;
+
+    for (;;)
+    {
+        while (b->tx_seq < total_pkts && uart_ring_free(&b->uart.tx) >= PKT_SIZE)
+        {
+            pkt_build(pkt, b->tx_seq++);
+            b->tx_bytes += uart_port_write(&b->uart, pkt, PKT_SIZE);
+        }
+
+        if (uart_loop_run_once(&b->loop, 10) < 0)
+        {
+            perror("Event loop failed");
+            return -1;
+        }
+
+        if (b->tx_seq < total_pkts || uart_ring_used(&b->uart.tx))
+        {
+            continue;
+        }
+        if (b->rx_bytes >= b->tx_bytes || now_ns() - b->last_rx_ns > idle_ns)
+        {
+            break;
+        }
+    }
+
+    end = (b->rx_bytes >= b->tx_bytes) ? now_ns() : b->last_rx_ns;
+    cpu1 = cpu_seconds();
+
+    printf("%-8u %-9lu %-9.1f ",
+           baud, b->tx_bytes,
+           b->rx_bytes * 8.0 / ((end - start) / 1e9) / 1000.0);
+    /* A pty has no line rate, so efficiency against the baud means nothing */
+    if (b->use_pty)
+    {
+        printf("%-6s ", "-");
+    }
+    else
+    {
+        printf("%-6.1f ", 100.0 * b->rx_bytes * 10.0 / ((end - start) / 1e9) / baud);
+    }
+    printf("%-7lu %-7lu ",
+           b->tx_bytes > b->rx_bytes ? b->tx_bytes - b->rx_bytes : 0,
+           b->corrupt);
+    printf("%-5.1f ", 100.0 * (cpu1 - cpu0) / ((end - start) / 1e9));
+    return 0;
+}
+
+static int bench_latency(struct bench *b, unsigned int baud, int pings)
+{
+    static uint32_t lat[MAX_PINGS];
+    uint8_t pkt[PKT_SIZE];
+    int timeout_ms = wire_timeout_ms(baud, 2 * PKT_SIZE);
+    int n = 0, lost = 0, i;
+
+    for (i = 0; i < pings; i++)
+    {
+        uint64_t deadline;
+
+        bench_reset(b);
+        b->ping_seq = i;
+        pkt_build(pkt, i);
+        uart_port_write(&b->uart, pkt, PKT_SIZE);
+
+        deadline = now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+        while (!b->got_pkt && now_ns() < deadline)
+        {
+            if (uart_loop_run_once(&b->loop, 1) < 0)
+            {
+                perror("Event loop failed");
+                return -1;
+            }
+        }
+
+        if (b->got_pkt)
+        {
+            lat[n++] = b->last_lat_us;
+        }
+        else
+        {
+            lost++;
+        }
+    }
+
+    if (!n)
+    {
+        printf("no echo (%d lost)\n", lost);
+        return 0;
+    }
+
+    qsort(lat, n, sizeof(lat[0]), cmp_u32);
+    printf("%-7u %-7u %-7u %-7u %d\n",
+           lat[n * 50 / 100], lat[n * 90 / 100], lat[n * 99 / 100], lat[n - 1], lost);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct bench *b;
+    struct uart_config cfg = { .baud = 115200, .vmin = 0, .vtime = 0 };
+    const char *device = UART_DEVICE;
+    unsigned int only_baud = 0;
+    unsigned int max_baud = 3686400;
+    double secs = 1.0;
+    int pings = 100;
+    size_t i;
+    int opt;
+
+    b = calloc(1, sizeof(*b));
+    if (!b)
+    {
+        perror("calloc");
+        return 1;
+    }
+
+    while ((opt = getopt(argc, argv, "d:b:m:s:n:p")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            device = optarg;
+            break;
+        case 'b':
+            only_baud = strtoul(optarg, NULL, 0);
+            break;
+        case 'm':
+            max_baud = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            secs = atof(optarg);
+            break;
+        case 'n':
+            pings = atoi(optarg);
+            break;
+        case 'p':
+            b->use_pty = 1;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-d device] [-p (pty loopback)] [-b baud] [-m max_baud]\n"
+                            "          [-s seconds per rate] [-n latency pings]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (pings < 1 || pings > MAX_PINGS)
+    {
+        fprintf(stderr, "Pings must be between 1 and %d\n", MAX_PINGS);
+        return 1;
+    }
+
+    if (uart_loop_init(&b->loop) < 0)
+    {
+        perror("Failed to create event loop");
+        return 1;
+    }
+
+    if (b->use_pty)
+    {
+        if (uart_port_open_pty(&b->peer, &b->uart, &cfg) < 0)
+        {
+            perror("Failed to open pty pair");
+            return 1;
+        }
+        b->peer.on_rx = peer_on_rx;
+        uart_loop_add(&b->loop, &b->peer);
+    }
+    else if (uart_port_open(&b->uart, device, &cfg) < 0)
+    {
+        perror("Failed to open UART device");
+        return 1;
+    }
+
+    b->uart.on_rx = bench_on_rx;
+    b->uart.arg = b;
+    uart_loop_add(&b->loop, &b->uart);
+
+    printf("Benchmarking %s (%s)\n", b->uart.path, b->use_pty ? "pty loopback" : "loopback wire");
+    printf("baud     bytes     kbit/s    eff%%   lost    corrupt cpu%%  p50us   p90us   p99us   maxus   lost_pings\n");
+
+    for (i = 0; i < sizeof(bench_bauds) / sizeof(bench_bauds[0]); i++)
+    {
+        cfg.baud = bench_bauds[i];
+        if ((only_baud && cfg.baud != only_baud) || cfg.baud > max_baud)
+        {
+            continue;
+        }
+
+        if (uart_configure(b->uart.fd, &cfg) < 0)
+        {
+            printf("%-8u not supported: %s\n", cfg.baud, strerror(errno));
+            continue;
+        }
+
+        if (bench_throughput(b, cfg.baud, secs) < 0 ||
+            bench_latency(b, cfg.baud, pings) < 0)
+        {
+            break;
+        }
+        fflush(stdout);
+    }
+
+    uart_port_close(&b->uart);
+    if (b->use_pty)
+    {
+        uart_port_close(&b->peer);
+    }
+    uart_loop_close(&b->loop);
+    free(b);
+    return 0;
+}
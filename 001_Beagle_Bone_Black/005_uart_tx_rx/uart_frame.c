@@ -0,0 +1,225 @@
+#include <string.h>
+
+#include "uart_frame.h"
+
+uint16_t frame_crc16(const uint8_t *data, size_t len)
+{
+    static uint16_t table[256];
+    static bool table_ready;
+    uint16_t crc = 0xFFFF;
+    size_t i;
+
+    if (!table_ready)
+    {
+        int n, bit;
+
+        for (n = 0; n < 256; n++)
+        {
+            uint16_t c = n << 8;
+
+            for (bit = 0; bit < 8; bit++)
+            {
+                c = (c & 0x8000) ? (c << 1) ^ 0x1021 : (c << 1);
+            }
+            table[n] = c;
+        }
+        table_ready = true;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        crc = (crc << 8) ^ table[((crc >> 8) ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+/* Streaming COBS encoder state, so payload and CRC can be fed separately */
+struct cobs_enc
+{
+    uint8_t *out;
+    size_t pos;
+    size_t size;
+    size_t code_pos;
+    uint8_t code;
+};
+
+static bool cobs_put(struct cobs_enc *enc, const uint8_t *data, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        if (data[i] != 0)
+        {
+            if (enc->pos >= enc->size)
+            {
+                return false;
+            }
+            enc->out[enc->pos++] = data[i];
+            enc->code++;
+        }
+
+        if (data[i] == 0 || enc->code == 0xFF)
+        {
+            if (enc->pos >= enc->size)
+            {
+                return false;
+            }
+            enc->out[enc->code_pos] = enc->code;
+            enc->code_pos = enc->pos++;
+            enc->code = 1;
+        }
+    }
+    return true;
+}
+
+/*
+ * Appends one complete frame (including the delimiter) to @out. Returns the
+ * number of bytes written, or 0 if @out is too small. Callers batch several
+ * frames by encoding them back to back and issuing a single write().
+ */
+size_t frame_encode(const void *payload, size_t len, uint8_t *out, size_t out_size)
+{
+    struct cobs_enc enc = { .out = out, .pos = 1, .size = out_size, .code_pos = 0, .code = 1 };
+    uint16_t crc = frame_crc16(payload, len);
+    uint8_t crc_le[FRAME_CRC_SIZE] = { crc & 0xFF, crc >> 8 };
+
+    if (!out_size || len > FRAME_MAX_PAYLOAD)
+    {
+        return 0;
+    }
+
+    if (!cobs_put(&enc, payload, len) || !cobs_put(&enc, crc_le, sizeof(crc_le)) ||
+        enc.pos >= enc.size)
+    {
+        return 0;
+    }
+
+    out[enc.code_pos] = enc.code;
+    out[enc.pos++] = FRAME_DELIM;
+    return enc.pos;
+}
+
+/* In-place COBS decode, output never overtakes input. Returns -1 on error. */
+static long cobs_decode(uint8_t *buf, size_t len)
+{
+    size_t in = 0, out = 0;
+
+    while (in < len)
+    {
+        uint8_t code = buf[in++];
+
+        if (code == 0 || in + code - 1 > len)
+        {
+            return -1;
+        }
+
+        memmove(&buf[out], &buf[in], code - 1);
+        out += code - 1;
+        in += code - 1;
+
+        if (code != 0xFF && in < len)
+        {
+            buf[out++] = 0;
+        }
+    }
+    return out;
+}
+
+static void frame_deliver(struct frame_decoder *dec, uint8_t *buf, size_t len)
+{
+    long n;
+    uint16_t crc;
+
+    /* Back to back delimiters are idle fill, not frames */
+    if (!len)
+    {
+        return;
+    }
+
+    n = cobs_decode(buf, len);
+    if (n < 0)
+    {
+        dec->cobs_errors++;
+        return;
+    }
+    if (n < FRAME_CRC_SIZE)
+    {
+        dec->crc_errors++;
+        return;
+    }
+
+    n -= FRAME_CRC_SIZE;
+    crc = buf[n] | (buf[n + 1] << 8);
+    if (crc != frame_crc16(buf, n))
+    {
+        dec->crc_errors++;
+        return;
+    }
+
+    dec->frames++;
+    dec->on_frame(buf, n, dec->arg);
+}
+
+void frame_decoder_init(struct frame_decoder *dec, frame_cb on_frame, void *arg)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->on_frame = on_frame;
+    dec->arg = arg;
+}
+
+static void frame_accumulate(struct frame_decoder *dec, const uint8_t *data, size_t len)
+{
+    if (dec->discard)
+    {
+        return;
+    }
+    if (dec->acc_len + len > sizeof(dec->acc))
+    {
+        dec->overruns++;
+        dec->discard = true;
+        dec->acc_len = 0;
+        return;
+    }
+    memcpy(&dec->acc[dec->acc_len], data, len);
+    dec->acc_len += len;
+}
+
+/*
+ * Frames that lie entirely inside @data are decoded in place and handed to
+ * the callback without copying; @data is clobbered. Only a frame split
+ * across two chunks goes through the accumulation buffer.
+ */
+void frame_decoder_feed(struct frame_decoder *dec, uint8_t *data, size_t len)
+{
+    while (len)
+    {
+        uint8_t *end = memchr(data, FRAME_DELIM, len);
+        size_t n;
+
+        if (!end)
+        {
+            frame_accumulate(dec, data, len);
+            return;
+        }
+
+        n = end - data;
+        if (dec->acc_len || dec->discard)
+        {
+            frame_accumulate(dec, data, n);
+            if (!dec->discard)
+            {
+                frame_deliver(dec, dec->acc, dec->acc_len);
+            }
+            dec->acc_len = 0;
+            dec->discard = false;
+        }
+        else
+        {
+            frame_deliver(dec, data, n);
+        }
+
+        data += n + 1;
+        len -= n + 1;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef UART_FRAME_H
+#define UART_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * COBS framing with a trailing CRC-16/CCITT-FALSE. Frames on the wire are
+ * COBS(payload | crc16_le) followed by a single 0x00 delimiter.
+ */
+#define FRAME_DELIM 0x00
+#define FRAME_CRC_SIZE 2
+#define FRAME_MAX_PAYLOAD 1024
+#define FRAME_MAX_ENCODED (FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE + (FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE) / 254 + 2)
+
+typedef void (*frame_cb)(const uint8_t *payload, size_t len, void *arg);
+
+struct frame_decoder
+{
+    uint8_t acc[FRAME_MAX_ENCODED];
+    size_t acc_len;
+    bool discard;
+    frame_cb on_frame;
+    void *arg;
+    unsigned long frames;
+    unsigned long crc_errors;
+    unsigned long cobs_errors;
+    unsigned long overruns;
+};
+
+uint16_t frame_crc16(const uint8_t *data, size_t len);
+size_t frame_encode(const void *payload, size_t len, uint8_t *out, size_t out_size);
+void frame_decoder_init(struct frame_decoder *dec, frame_cb on_frame, void *arg);
+void frame_decoder_feed(struct frame_decoder *dec, uint8_t *data, size_t len);
+
+#endif
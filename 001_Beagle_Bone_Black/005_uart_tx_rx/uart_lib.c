@@ -0,0 +1,490 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/epoll.h>
+
+#include "uart_lib.h"
+
+#define UART_RING_MASK (UART_RING_SIZE - 1)
+#define UART_MAX_EVENTS 16
+
+size_t uart_ring_used(const struct uart_ring *ring)
+{
+    return ring->head - ring->tail;
+}
+
+size_t uart_ring_free(const struct uart_ring *ring)
+{
+    return UART_RING_SIZE - uart_ring_used(ring);
+}
+
+/* Largest contiguous free span starting at head */
+static size_t ring_write_span(const struct uart_ring *ring, uint8_t **ptr)
+{
+    size_t off = ring->head & UART_RING_MASK;
+    size_t len = UART_RING_SIZE - off;
+
+    *ptr = (uint8_t *)&ring->buf[off];
+    return (len < uart_ring_free(ring)) ? len : uart_ring_free(ring);
+}
+
+/* Largest contiguous used span starting at tail */
+static size_t ring_read_span(const struct uart_ring *ring, const uint8_t **ptr)
+{
+    size_t off = ring->tail & UART_RING_MASK;
+    size_t len = UART_RING_SIZE - off;
+
+    *ptr = &ring->buf[off];
+    return (len < uart_ring_used(ring)) ? len : uart_ring_used(ring);
+}
+
+static speed_t baud_to_speed(unsigned int baud)
+{
+    static const struct { unsigned int baud; speed_t speed; } table[] = {
+        { 9600, B9600 },       { 19200, B19200 },     { 38400, B38400 },
+        { 57600, B57600 },     { 115200, B115200 },   { 230400, B230400 },
+        { 460800, B460800 },   { 500000, B500000 },   { 576000, B576000 },
+        { 921600, B921600 },   { 1000000, B1000000 }, { 1152000, B1152000 },
+        { 1500000, B1500000 }, { 2000000, B2000000 }, { 2500000, B2500000 },
+        { 3000000, B3000000 }, { 3500000, B3500000 }, { 4000000, B4000000 },
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(table) / sizeof(table[0]); i++)
+    {
+        if (table[i].baud == baud)
+        {
+            return table[i].speed;
+        }
+    }
+    return B0;
+}
+
+/*
+ * Raw 8N1, no flow control, no echo, no line discipline processing.
+ * Rates without a Bxxx constant (e.g. 1843200, 3686400) go through BOTHER.
+ */
+int uart_configure(int fd, const struct uart_config *cfg)
+{
+    struct termios tio;
+    speed_t speed = baud_to_speed(cfg->baud);
+
+    if (!cfg->baud)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (tcgetattr(fd, &tio) < 0)
+    {
+        return -1;
+    }
+
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = cfg->vmin;
+    tio.c_cc[VTIME] = cfg->vtime;
+    cfsetispeed(&tio, (speed == B0) ? B38400 : speed);
+    cfsetospeed(&tio, (speed == B0) ? B38400 : speed);
+
+    if (tcsetattr(fd, TCSANOW, &tio) < 0)
+    {
+        return -1;
+    }
+    if (speed == B0 && uart_set_custom_baud(fd, cfg->baud) < 0)
+    {
+        return -1;
+    }
+    return tcflush(fd, TCIOFLUSH);
+}
+
+static void port_init(struct uart_port *port, int fd, const char *path)
+{
+    memset(port, 0, sizeof(*port));
+    port->fd = fd;
+    snprintf(port->path, sizeof(port->path), "%s", path);
+}
+
+int uart_port_open(struct uart_port *port, const char *path, const struct uart_config *cfg)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    if (uart_configure(fd, cfg) < 0)
+    {
+        int err = errno;
+
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    port_init(port, fd, path);
+    return 0;
+}
+
+/*
+ * Host-testable stand-in for a wired UART: the slave side gets the same
+ * raw configuration as a real tty, the master side is the "far end".
+ */
+int uart_port_open_pty(struct uart_port *master, struct uart_port *slave, const struct uart_config *cfg)
+{
+    int mfd, sfd;
+    char *name;
+
+    mfd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (mfd < 0)
+    {
+        return -1;
+    }
+
+    if (grantpt(mfd) < 0 || unlockpt(mfd) < 0 || !(name = ptsname(mfd)))
+    {
+        close(mfd);
+        return -1;
+    }
+
+    sfd = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (sfd < 0)
+    {
+        close(mfd);
+        return -1;
+    }
+
+    if (uart_configure(sfd, cfg) < 0)
+    {
+        close(sfd);
+        close(mfd);
+        return -1;
+    }
+
+    port_init(slave, sfd, name);
+    port_init(master, mfd, "/dev/ptmx");
+    return 0;
+}
+
+void uart_port_close(struct uart_port *port)
+{
+    if (port->loop)
+    {
+        uart_loop_remove(port->loop, port);
+    }
+    if (port->fd >= 0)
+    {
+        close(port->fd);
+    }
+    port->fd = -1;
+}
+
+/* Re-arm epoll for whatever the rings currently allow */
+static void port_update_events(struct uart_port *port)
+{
+    struct epoll_event ev;
+    uint32_t events = 0;
+
+    if (!port->loop)
+    {
+        return;
+    }
+
+    if (uart_ring_free(&port->rx))
+    {
+        events |= EPOLLIN;
+    }
+    if (uart_ring_used(&port->tx))
+    {
+        events |= EPOLLOUT;
+    }
+    if (events == port->events)
+    {
+        return;
+    }
+
+    ev.events = events;
+    ev.data.ptr = port;
+    if (epoll_ctl(port->loop->epfd, EPOLL_CTL_MOD, port->fd, &ev) == 0)
+    {
+        port->events = events;
+    }
+}
+
+/*
+ * Drains the fd into the RX ring. Returns 1 on EOF: epoll reported the fd
+ * readable but the first read() came back empty, which is how a hung-up tty
+ * looks (EPOLLIN|EPOLLHUP with read() == 0). A zero read after data is only
+ * a VMIN=0 port running dry.
+ */
+static int port_fill_rx(struct uart_port *port)
+{
+    uint8_t *ptr;
+    size_t span;
+    ssize_t n;
+    bool got = false;
+
+    while ((span = ring_write_span(&port->rx, &ptr)) > 0)
+    {
+        n = read(port->fd, ptr, span);
+        if (n > 0)
+        {
+            port->rx.head += n;
+            port->rx_bytes += n;
+            got = true;
+            if ((size_t)n < span)
+            {
+                break;
+            }
+            continue;
+        }
+        if (n == 0)
+        {
+            return got ? 0 : 1;
+        }
+        if (errno == EAGAIN)
+        {
+            break;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+static int port_flush_tx(struct uart_port *port)
+{
+    const uint8_t *ptr;
+    size_t span;
+    ssize_t n;
+
+    while ((span = ring_read_span(&port->tx, &ptr)) > 0)
+    {
+        n = write(port->fd, ptr, span);
+        if (n > 0)
+        {
+            port->tx.tail += n;
+            port->tx_bytes += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN)
+        {
+            return -1;
+        }
+        break;
+    }
+    return 0;
+}
+
+/* Zero-copy access to the oldest contiguous RX span, release it with consume */
+size_t uart_port_peek(struct uart_port *port, uint8_t **data)
+{
+    return ring_read_span(&port->rx, (const uint8_t **)data);
+}
+
+void uart_port_consume(struct uart_port *port, size_t len)
+{
+    size_t used = uart_ring_used(&port->rx);
+
+    port->rx.tail += (len < used) ? len : used;
+    port_update_events(port);
+}
+
+size_t uart_port_read(struct uart_port *port, void *buf, size_t len)
+{
+    const uint8_t *ptr;
+    size_t done = 0;
+    size_t span;
+
+    while (done < len && (span = ring_read_span(&port->rx, &ptr)) > 0)
+    {
+        if (span > len - done)
+        {
+            span = len - done;
+        }
+        memcpy((uint8_t *)buf + done, ptr, span);
+        port->rx.tail += span;
+        done += span;
+    }
+
+    port_update_events(port);
+    return done;
+}
+
+/* Queues as much as fits in the TX ring and returns the amount queued */
+size_t uart_port_write(struct uart_port *port, const void *buf, size_t len)
+{
+    uint8_t *ptr;
+    size_t done = 0;
+    size_t span;
+
+    while (done < len && (span = ring_write_span(&port->tx, &ptr)) > 0)
+    {
+        if (span > len - done)
+        {
+            span = len - done;
+        }
+        memcpy(ptr, (const uint8_t *)buf + done, span);
+        port->tx.head += span;
+        done += span;
+    }
+
+    port_flush_tx(port);
+    port_update_events(port);
+    return done;
+}
+
+int uart_loop_init(struct uart_loop *loop)
+{
+    memset(loop, 0, sizeof(*loop));
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    return (loop->epfd < 0) ? -1 : 0;
+}
+
+int uart_loop_add(struct uart_loop *loop, struct uart_port *port)
+{
+    struct epoll_event ev;
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = port;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, port->fd, &ev) < 0)
+    {
+        return -1;
+    }
+
+    port->loop = loop;
+    port->events = EPOLLIN;
+    loop->nports++;
+    port_update_events(port);
+    return 0;
+}
+
+void uart_loop_remove(struct uart_loop *loop, struct uart_port *port)
+{
+    if (port->loop != loop)
+    {
+        return;
+    }
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, port->fd, NULL);
+    port->loop = NULL;
+    port->events = 0;
+    loop->nports--;
+}
+
+static void port_hangup(struct uart_port *port)
+{
+    uart_loop_remove(port->loop, port);
+    if (port->on_hangup)
+    {
+        port->on_hangup(port, port->arg);
+    }
+}
+
+/* Dispatches one epoll_wait() worth of events, returns the event count */
+int uart_loop_run_once(struct uart_loop *loop, int timeout_ms)
+{
+    struct epoll_event events[UART_MAX_EVENTS];
+    int n, i;
+
+    n = epoll_wait(loop->epfd, events, UART_MAX_EVENTS, timeout_ms);
+    if (n < 0)
+    {
+        return (errno == EINTR) ? 0 : -1;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        struct uart_port *port = events[i].data.ptr;
+        uint32_t ev = events[i].events;
+
+        if (ev & EPOLLIN)
+        {
+            size_t before = uart_ring_used(&port->rx);
+            int ret = port_fill_rx(port);
+
+            if (ret < 0)
+            {
+                port_hangup(port);
+                continue;
+            }
+            if (uart_ring_used(&port->rx) != before && port->on_rx)
+            {
+                port->on_rx(port, port->arg);
+            }
+            if (ret > 0 && port->loop)
+            {
+                port_hangup(port);
+                continue;
+            }
+        }
+
+        if (!port->loop)
+        {
+            continue;
+        }
+
+        if (ev & EPOLLOUT)
+        {
+            if (port_flush_tx(port) < 0)
+            {
+                port_hangup(port);
+                continue;
+            }
+            /* Let forwarding handlers that stalled on a full TX ring resume */
+            if (!(ev & EPOLLIN) && uart_ring_used(&port->rx) && port->on_rx)
+            {
+                port->on_rx(port, port->arg);
+            }
+        }
+
+        if (ev & (EPOLLERR | EPOLLHUP) && !(ev & EPOLLIN))
+        {
+            port_hangup(port);
+            continue;
+        }
+
+        port_update_events(port);
+    }
+    return n;
+}
+
+int uart_loop_run(struct uart_loop *loop)
+{
+    loop->running = true;
+    while (loop->running && loop->nports > 0)
+    {
+        if (uart_loop_run_once(loop, -1) < 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void uart_loop_stop(struct uart_loop *loop)
+{
+    loop->running = false;
+}
+
+void uart_loop_close(struct uart_loop *loop)
+{
+    if (loop->epfd >= 0)
+    {
+        close(loop->epfd);
+    }
+    loop->epfd = -1;
+}
@@ -0,0 +1,75 @@
+#ifndef UART_LIB_H
+#define UART_LIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Must be a power of two, indices are free running and masked on access */
+#define UART_RING_SIZE 4096
+
+struct uart_ring
+{
+    uint8_t buf[UART_RING_SIZE];
+    size_t head;
+    size_t tail;
+};
+
+struct uart_config
+{
+    unsigned int baud;
+    unsigned char vmin;
+    unsigned char vtime;
+};
+
+struct uart_loop;
+struct uart_port;
+
+typedef void (*uart_rx_cb)(struct uart_port *port, void *arg);
+typedef void (*uart_hangup_cb)(struct uart_port *port, void *arg);
+
+struct uart_port
+{
+    int fd;
+    char path[64];
+    struct uart_ring rx;
+    struct uart_ring tx;
+    struct uart_loop *loop;
+    uint32_t events;
+    uart_rx_cb on_rx;
+    uart_hangup_cb on_hangup;
+    void *arg;
+    unsigned long rx_bytes;
+    unsigned long tx_bytes;
+};
+
+struct uart_loop
+{
+    int epfd;
+    int nports;
+    bool running;
+};
+
+size_t uart_ring_used(const struct uart_ring *ring);
+size_t uart_ring_free(const struct uart_ring *ring);
+
+int uart_configure(int fd, const struct uart_config *cfg);
+int uart_set_custom_baud(int fd, unsigned int baud);
+int uart_port_open(struct uart_port *port, const char *path, const struct uart_config *cfg);
+int uart_port_open_pty(struct uart_port *master, struct uart_port *slave, const struct uart_config *cfg);
+void uart_port_close(struct uart_port *port);
+size_t uart_port_read(struct uart_port *port, void *buf, size_t len);
+size_t uart_port_peek(struct uart_port *port, uint8_t **data);
+void uart_port_consume(struct uart_port *port, size_t len);
+size_t uart_port_write(struct uart_port *port, const void *buf, size_t len);
+
+int uart_loop_init(struct uart_loop *loop);
+int uart_loop_add(struct uart_loop *loop, struct uart_port *port);
+void uart_loop_remove(struct uart_loop *loop, struct uart_port *port);
+int uart_loop_run_once(struct uart_loop *loop, int timeout_ms);
+int uart_loop_run(struct uart_loop *loop);
+void uart_loop_stop(struct uart_loop *loop);
+void uart_loop_close(struct uart_loop *loop);
+
+#endif
@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+
+#include "uart_lib.h"
+#include "uart_frame.h"
+
+#define UART_DEVICE "/dev/ttyS2"
+#define MAX_SAMPLES 10000
+#define REC_BUF_SIZE 4096
+#define FRAME_TIMEOUT_MS 200
+
+/*
+ * Timestamp jitter of the 8250_omap stamped raw RX records. A COBS frame
+ * carrying its send time goes out every period on a loopback wire and is
+ * read back from ttySn-raw as {stamp, bytes} records. Subtracting the send
+ * time and the frame's time on the wire leaves the stamping delay; its
+ * spread is the measured bound on timestamp jitter.
+ *
+ * Needs "ti,rx-dma-raw" in the overlay, 1 in rx_dma/raw_stamps and 0x00 in
+ * rx_delimiter so the frame end is stamped from the UART interrupt.
+ */
+
+/* Header of a stamped record, mirrors struct omap8250_rx_stamp */
+struct rx_stamp
+{
+    uint64_t ns;
+    uint32_t len;
+    uint32_t src;
+};
+
+static const char *const stamp_src[] = { "irq", "dma", "poll" };
+
+struct stamp_bench
+{
+    struct frame_decoder dec;
+    uint64_t rec_ns;
+    uint32_t rec_src;
+    uint64_t wire_ns;
+    int64_t lat[MAX_SAMPLES];
+    int n;
+    unsigned long src_count[3];
+    unsigned long short_frames;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* The stamp that counts is the one of the record holding the delimiter */
+static void stamp_on_frame(const uint8_t *payload, size_t len, void *arg)
+{
+    struct stamp_bench *sb = arg;
+    uint64_t tx_ns;
+
+    if (len < sizeof(uint32_t) + sizeof(tx_ns) || sb->n >= MAX_SAMPLES)
+    {
+        sb->short_frames++;
+        return;
+    }
+
+    memcpy(&tx_ns, &payload[sizeof(uint32_t)], sizeof(tx_ns));
+    sb->lat[sb->n++] = (int64_t)(sb->rec_ns - tx_ns - sb->wire_ns);
+    if (sb->rec_src < 3)
+    {
+        sb->src_count[sb->rec_src]++;
+    }
+}
+
+static int stamp_read(struct stamp_bench *sb, int raw_fd)
+{
+    static uint8_t buf[REC_BUF_SIZE];
+    struct rx_stamp rec;
+    ssize_t n;
+
+    n = read(raw_fd, buf, sizeof(buf));
+    if (n < 0)
+    {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+    if ((size_t)n < sizeof(rec))
+    {
+        errno = EPROTO;
+        return -1;
+    }
+
+    memcpy(&rec, buf, sizeof(rec));
+    sb->rec_ns = rec.ns;
+    sb->rec_src = rec.src;
+    frame_decoder_feed(&sb->dec, buf + sizeof(rec), rec.len);
+    return 0;
+}
+
+/* Waits until frame @want has been decoded or the timeout runs out */
+static int stamp_wait(struct stamp_bench *sb, int raw_fd, int want)
+{
+    uint64_t deadline = now_ns() + FRAME_TIMEOUT_MS * 1000000ULL;
+    struct pollfd pfd = { .fd = raw_fd, .events = POLLIN };
+
+    while (sb->n < want)
+    {
+        uint64_t now = now_ns();
+
+        if (now >= deadline)
+        {
+            return 0;
+        }
+        if (poll(&pfd, 1, (int)((deadline - now) / 1000000) + 1) < 0 && errno != EINTR)
+        {
+            return -1;
+        }
+        if ((pfd.revents & POLLIN) && stamp_read(sb, raw_fd) < 0)
+        {
+            return -1;
+        }
+        if (pfd.revents & (POLLERR | POLLHUP))
+        {
+            errno = EIO;
+            return -1;
+        }
+    }
+    return 1;
+}
+
+static void timespec_add_ns(struct timespec *ts, uint64_t ns)
+{
+    ns += ts->tv_nsec;
+    ts->tv_sec += ns / 1000000000ULL;
+    ts->tv_nsec = ns % 1000000000ULL;
+}
+
+int main(int argc, char *argv[])
+{
+    struct uart_config cfg = { .baud = 115200, .vmin = 0, .vtime = 0 };
+    const char *device = UART_DEVICE;
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t frame[FRAME_MAX_ENCODED];
+    struct stamp_bench *sb;
+    struct uart_port uart;
+    struct timespec next;
+    char raw_path[80];
+    int count = 1000, period_ms = 10, payload_len = 32;
+    int raw_fd, lost = 0, i, opt;
+    size_t frame_len = 0;
+
+    while ((opt = getopt(argc, argv, "d:b:n:p:l:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            device = optarg;
+            break;
+        case 'b':
+            cfg.baud = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 'p':
+            period_ms = atoi(optarg);
+            break;
+        case 'l':
+            payload_len = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-d device] [-b baud] [-n frames] [-p period_ms] [-l payload]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (count < 1 || count > MAX_SAMPLES || period_ms < 1 ||
+        payload_len < 12 || payload_len > FRAME_MAX_PAYLOAD)
+    {
+        fprintf(stderr, "Need 1..%d frames, a period of at least 1 ms and a 12..%d byte payload\n",
+                MAX_SAMPLES, FRAME_MAX_PAYLOAD);
+        return 1;
+    }
+
+    sb = calloc(1, sizeof(*sb));
+    if (!sb)
+    {
+        perror("calloc");
+        return 1;
+    }
+    frame_decoder_init(&sb->dec, stamp_on_frame, sb);
+
+    /* The tty owns the line settings and the DMA channel, it has to stay open */
+    if (uart_port_open(&uart, device, &cfg) < 0)
+    {
+        perror("Failed to open UART device");
+        return 1;
+    }
+
+    snprintf(raw_path, sizeof(raw_path), "%s-raw", device);
+    raw_fd = open(raw_path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (raw_fd < 0)
+    {
+        perror("Failed to open raw RX device");
+        uart_port_close(&uart);
+        return 1;
+    }
+
+    memset(payload, 0xA5, payload_len);
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (i = 0; i < count; i++)
+    {
+        uint32_t seq = i;
+        uint64_t tx_ns;
+        int ret;
+
+        timespec_add_ns(&next, (uint64_t)period_ms * 1000000ULL);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        tx_ns = now_ns();
+        memcpy(payload, &seq, sizeof(seq));
+        memcpy(&payload[sizeof(seq)], &tx_ns, sizeof(tx_ns));
+        frame_len = frame_encode(payload, payload_len, frame, sizeof(frame));
+        sb->wire_ns = frame_len * 10 * 1000000000ULL / cfg.baud;
+
+        if (uart_port_write(&uart, frame, frame_len) != frame_len)
+        {
+            fprintf(stderr, "TX ring full\n");
+            break;
+        }
+
+        ret = stamp_wait(sb, raw_fd, sb->n + 1);
+        if (ret < 0)
+        {
+            perror("Raw read failed");
+            break;
+        }
+        if (!ret)
+        {
+            lost++;
+        }
+    }
+
+    printf("%s at %u baud, %d frames of %zu bytes every %d ms\n",
+           device, cfg.baud, count, frame_len, period_ms);
+
+    if (sb->n)
+    {
+        int64_t *lat = sb->lat;
+        int n = sb->n;
+
+        qsort(lat, n, sizeof(lat[0]), cmp_i64);
+        printf("stamp delay us: min %.1f p50 %.1f p99 %.1f max %.1f\n",
+               lat[0] / 1e3, lat[n * 50 / 100] / 1e3, lat[n * 99 / 100] / 1e3, lat[n - 1] / 1e3);
+        printf("jitter bound:   %.1f us (p99 - min %.1f us)\n",
+               (lat[n - 1] - lat[0]) / 1e3, (lat[n * 99 / 100] - lat[0]) / 1e3);
+    }
+    printf("frames: %d stamped, %d lost, %lu short, %lu crc, %lu cobs\n",
+           sb->n, lost, sb->short_frames, sb->dec.crc_errors, sb->dec.cobs_errors);
+    for (i = 0; i < 3; i++)
+    {
+        printf("stamp source %-4s %lu\n", stamp_src[i], sb->src_count[i]);
+    }
+
+    close(raw_fd);
+    uart_port_close(&uart);
+    free(sb);
+    return 0;
+}
@@ -1,9 +1,329 @@
 #include <linux/module.h>
 #include <linux/spi/spi.h>
 #include <linux/init.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/random.h>
+#include <linux/ktime.h>
+#include <linux/bitops.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+
+#define SELFTEST_MAX_LEN    4096
+#define SELFTEST_MAX_STEPS  16
+
+enum selftest_pattern {
+    PATTERN_PRBS7,
+    PATTERN_PRBS15,
+    PATTERN_PRBS31,
+    PATTERN_WALK_ONES,
+    PATTERN_ZEROS,
+    PATTERN_ONES,
+    PATTERN_RANDOM,
+};
+
+static const char * const pattern_names[] = {
+    [PATTERN_PRBS7]     = "prbs7",
+    [PATTERN_PRBS15]    = "prbs15",
+    [PATTERN_PRBS31]    = "prbs31",
+    [PATTERN_WALK_ONES] = "walk1",
+    [PATTERN_ZEROS]     = "zeros",
+    [PATTERN_ONES]      = "ones",
+    [PATTERN_RANDOM]    = "random",
+};
+
+struct selftest_result {
+    u32 speed_hz;
+    u32 effective_hz;
+    u64 bits;
+    u64 bit_errors;
+    u64 elapsed_ns;
+    int status;
+};
 
 struct spi_device *g_spi_device;
 
+/*
+ * Self-test knobs, all under /sys/kernel/debug/bbb_spi0/. Writing anything
+ * to "run" sweeps the clock from min_hz to max_hz (doubling each step) and
+ * the per-step BER/throughput table is then readable from "results".
+ */
+static struct dentry *selftest_dir;
+static DEFINE_MUTEX(selftest_lock);
+static enum selftest_pattern selftest_pattern = PATTERN_PRBS7;
+static u32 selftest_len = 256;
+static u32 selftest_iterations = 16;
+static u32 selftest_min_hz = 100000;
+static u32 selftest_max_hz = 48000000;
+static struct selftest_result selftest_results[SELFTEST_MAX_STEPS];
+static int selftest_steps;
+static enum selftest_pattern selftest_run_pattern;
+static u32 selftest_run_len;
+static u32 selftest_run_iterations;
+static u32 selftest_max_clean_hz;
+
+/* Fibonacci LFSR x^n + x^tap + 1, shifted out MSB first */
+static u8 prbs_next_byte(u32 *lfsr, unsigned int n, unsigned int tap)
+{
+    u8 byte = 0;
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        u32 bit = ((*lfsr >> (n - 1)) ^ (*lfsr >> (tap - 1))) & 1;
+
+        *lfsr = ((*lfsr << 1) | bit) & GENMASK(n - 1, 0);
+        byte = (byte << 1) | bit;
+    }
+    return byte;
+}
+
+static void selftest_fill(u8 *buf, size_t len, u32 *lfsr)
+{
+    size_t i;
+
+    switch (selftest_run_pattern)
+    {
+    case PATTERN_PRBS7:
+        for (i = 0; i < len; i++)
+            buf[i] = prbs_next_byte(lfsr, 7, 6);
+        break;
+    case PATTERN_PRBS15:
+        for (i = 0; i < len; i++)
+            buf[i] = prbs_next_byte(lfsr, 15, 14);
+        break;
+    case PATTERN_PRBS31:
+        for (i = 0; i < len; i++)
+            buf[i] = prbs_next_byte(lfsr, 31, 28);
+        break;
+    case PATTERN_WALK_ONES:
+        for (i = 0; i < len; i++)
+            buf[i] = BIT(i % 8);
+        break;
+    case PATTERN_ZEROS:
+        memset(buf, 0x00, len);
+        break;
+    case PATTERN_ONES:
+        memset(buf, 0xFF, len);
+        break;
+    case PATTERN_RANDOM:
+        get_random_bytes(buf, len);
+        break;
+    }
+}
+
+static void selftest_run_step(struct spi_device *spi, struct selftest_result *res,
+                              u8 *tx, u8 *rx, u32 *lfsr)
+{
+    struct spi_message msg;
+    struct spi_transfer tr;
+    ktime_t start;
+    size_t i;
+    u32 iter;
+
+    for (iter = 0; iter < selftest_run_iterations; iter++)
+    {
+        selftest_fill(tx, selftest_run_len, lfsr);
+        memset(rx, 0, selftest_run_len);
+
+        memset(&tr, 0, sizeof(tr));
+        tr.tx_buf = tx;
+        tr.rx_buf = rx;
+        tr.len = selftest_run_len;
+        tr.bits_per_word = 8;
+        tr.speed_hz = res->speed_hz;
+
+        spi_message_init(&msg);
+        spi_message_add_tail(&tr, &msg);
+
+        start = ktime_get();
+        res->status = spi_sync(spi, &msg);
+        res->elapsed_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+        if (res->status)
+        {
+            dev_err(&spi->dev, "Self-test transfer at %u Hz failed: %d\n",
+                    res->speed_hz, res->status);
+            return;
+        }
+
+        if (tr.effective_speed_hz)
+            res->effective_hz = tr.effective_speed_hz;
+
+        res->bits += (u64)selftest_run_len * 8;
+        for (i = 0; i < selftest_run_len; i++)
+            res->bit_errors += hweight8(tx[i] ^ rx[i]);
+    }
+}
+
+static int selftest_run(struct spi_device *spi)
+{
+    struct selftest_result *res;
+    u32 lfsr = GENMASK(30, 0);
+    bool clean = true;
+    u8 *tx, *rx;
+    u32 min_hz = READ_ONCE(selftest_min_hz);
+    u32 max_hz = READ_ONCE(selftest_max_hz);
+    u32 hz;
+
+    /* debugfs u32 knobs are not locked, so run on a snapshot of them */
+    selftest_run_pattern = selftest_pattern;
+    selftest_run_len = READ_ONCE(selftest_len);
+    selftest_run_iterations = READ_ONCE(selftest_iterations);
+
+    if (!selftest_run_len || selftest_run_len > SELFTEST_MAX_LEN ||
+        !selftest_run_iterations || !min_hz || min_hz > max_hz)
+    {
+        selftest_steps = 0;
+        return -EINVAL;
+    }
+
+    tx = kmalloc(selftest_run_len, GFP_KERNEL);
+    rx = kmalloc(selftest_run_len, GFP_KERNEL);
+    if (!tx || !rx)
+    {
+        kfree(tx);
+        kfree(rx);
+        return -ENOMEM;
+    }
+
+    selftest_steps = 0;
+    selftest_max_clean_hz = 0;
+    hz = min_hz;
+
+    while (selftest_steps < SELFTEST_MAX_STEPS)
+    {
+        res = &selftest_results[selftest_steps++];
+        memset(res, 0, sizeof(*res));
+        res->speed_hz = hz;
+
+        selftest_run_step(spi, res, tx, rx, &lfsr);
+
+        /* Only a contiguous run of clean steps counts as a safe frequency */
+        if (res->status || res->bit_errors)
+            clean = false;
+        else if (clean)
+            selftest_max_clean_hz = hz;
+
+        if (hz == max_hz)
+            break;
+        hz = (hz > max_hz / 2) ? max_hz : hz * 2;
+    }
+
+    dev_info(&spi->dev, "SPI self-test (%s, %u bytes x %u): max clean frequency %u Hz\n",
+             pattern_names[selftest_run_pattern], selftest_run_len, selftest_run_iterations,
+             selftest_max_clean_hz);
+
+    kfree(tx);
+    kfree(rx);
+    return 0;
+}
+
+static ssize_t selftest_run_write(struct file *file, const char __user *buf,
+                                  size_t len, loff_t *ppos)
+{
+    int ret;
+
+    if (!g_spi_device)
+        return -ENODEV;
+
+    mutex_lock(&selftest_lock);
+    ret = selftest_run(g_spi_device);
+    mutex_unlock(&selftest_lock);
+
+    return ret ? ret : len;
+}
+
+static const struct file_operations selftest_run_fops = {
+    .owner = THIS_MODULE,
+    .write = selftest_run_write,
+};
+
+static ssize_t selftest_pattern_read(struct file *file, char __user *buf,
+                                     size_t len, loff_t *ppos)
+{
+    char kbuf[16];
+    int n;
+
+    n = scnprintf(kbuf, sizeof(kbuf), "%s\n", pattern_names[selftest_pattern]);
+    return simple_read_from_buffer(buf, len, ppos, kbuf, n);
+}
+
+static ssize_t selftest_pattern_write(struct file *file, const char __user *buf,
+                                      size_t len, loff_t *ppos)
+{
+    char kbuf[16];
+    size_t clen = min(len, sizeof(kbuf) - 1);
+    int idx;
+
+    if (copy_from_user(kbuf, buf, clen))
+        return -EFAULT;
+    kbuf[clen] = '\0';
+
+    idx = sysfs_match_string(pattern_names, kbuf);
+    if (idx < 0)
+        return idx;
+
+    mutex_lock(&selftest_lock);
+    selftest_pattern = idx;
+    mutex_unlock(&selftest_lock);
+
+    return len;
+}
+
+static const struct file_operations selftest_pattern_fops = {
+    .owner = THIS_MODULE,
+    .read  = selftest_pattern_read,
+    .write = selftest_pattern_write,
+};
+
+static int selftest_results_show(struct seq_file *s, void *unused)
+{
+    int i;
+
+    mutex_lock(&selftest_lock);
+    seq_printf(s, "pattern %s, %u bytes x %u transfers\n",
+               pattern_names[selftest_run_pattern], selftest_run_len, selftest_run_iterations);
+    seq_puts(s, "req_hz      eff_hz      bits        errors      ber          kbit/s\n");
+
+    for (i = 0; i < selftest_steps; i++)
+    {
+        const struct selftest_result *res = &selftest_results[i];
+        u64 kbps = res->elapsed_ns ? div64_u64(res->bits * 1000000ULL, res->elapsed_ns) : 0;
+        u64 ber_ppb = res->bits ? div64_u64(res->bit_errors * NSEC_PER_SEC, res->bits) : 0;
+        u32 ber_frac;
+
+        if (res->status)
+        {
+            seq_printf(s, "%-11u transfer failed: %d\n", res->speed_hz, res->status);
+            continue;
+        }
+
+        /* Plain u64 '/' and '%' need libgcc helpers on 32-bit ARM */
+        seq_printf(s, "%-11u %-11u %-11llu %-11llu %llu.%09u  %llu\n",
+                   res->speed_hz, res->effective_hz, res->bits, res->bit_errors,
+                   div_u64_rem(ber_ppb, NSEC_PER_SEC, &ber_frac), ber_frac, kbps);
+    }
+
+    seq_printf(s, "max_clean_hz %u\n", selftest_max_clean_hz);
+    mutex_unlock(&selftest_lock);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(selftest_results);
+
+static void selftest_debugfs_init(void)
+{
+    selftest_dir = debugfs_create_dir("bbb_spi0", NULL);
+    debugfs_create_file("pattern", 0644, selftest_dir, NULL, &selftest_pattern_fops);
+    debugfs_create_u32("len", 0644, selftest_dir, &selftest_len);
+    debugfs_create_u32("iterations", 0644, selftest_dir, &selftest_iterations);
+    debugfs_create_u32("min_hz", 0644, selftest_dir, &selftest_min_hz);
+    debugfs_create_u32("max_hz", 0644, selftest_dir, &selftest_max_hz);
+    debugfs_create_file("run", 0200, selftest_dir, NULL, &selftest_run_fops);
+    debugfs_create_file("results", 0444, selftest_dir, NULL, &selftest_results_fops);
+}
+
 static int spi0_probe(struct spi_device *spi)
 {
     int ret;
@@ -33,19 +353,23 @@ static int spi0_probe(struct spi_device *spi)
     {
         dev_err(&spi->dev, "SPI transfer failed: %d\n", ret);
     }
-    else if (rx != tx) 
+    else if (rx != tx)
     {
         dev_err(&spi->dev, "SPI loopback mismatch: sent 0x%02X, received 0x%02X\n", tx, rx);
     }
-    else 
+    else
     {
         dev_info(&spi->dev, "SPI received: 0x%02X\n", rx);
     }
+
+    selftest_debugfs_init();
     return 0;
 }
 
 static void spi0_remove(struct spi_device *spi)
 {
+    debugfs_remove_recursive(selftest_dir);
+    g_spi_device = NULL;
     dev_info(&spi->dev, "SPI loopback driver unloaded\n");
 }
 
@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+
+#include "gpio_lib.h"
+
+#define GPIO_CHIP "/dev/gpiochip1"
+#define MAX_EVENTS 1024
+
+struct edge_source
+{
+    struct gpio_lines out;
+    int pull_fd;
+    int level;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int parse_offsets(const char *arg, unsigned int *offsets)
+{
+    char *end;
+    int n = 0;
+
+    while (*arg && n < GPIO_V2_LINES_MAX)
+    {
+        offsets[n++] = strtoul(arg, &end, 0);
+        if (end == arg)
+        {
+            return -1;
+        }
+        arg = (*end == ',') ? end + 1 : end;
+    }
+    return n;
+}
+
+/*
+ * Same bus pattern written two ways: one SET_VALUES per line, which is what
+ * the v1 single-line handles and sysfs value files boil down to, and one
+ * SET_VALUES for the whole request.
+ */
+static int bench_toggle(struct gpio_lines *bus, double secs)
+{
+    uint64_t mask = gpio_lines_mask(bus);
+    uint64_t deadline, start, updates, bits = 0, got;
+    unsigned long ioctls;
+    unsigned int i;
+    int batched;
+
+    printf("mode      lines updates/s   line_toggles/s ioctls/s\n");
+    for (batched = 0; batched <= 1; batched++)
+    {
+        updates = 0;
+        ioctls = bus->ioctls;
+        start = now_ns();
+        deadline = start + (uint64_t)(secs * 1e9);
+
+        while (now_ns() < deadline)
+        {
+            bits ^= mask;
+            if (batched)
+            {
+                if (gpio_lines_set(bus, bits, mask) < 0)
+                {
+                    return -1;
+                }
+            }
+            else
+            {
+                for (i = 0; i < bus->num; i++)
+                {
+                    if (gpio_lines_set(bus, bits, 1ULL << i) < 0)
+                    {
+                        return -1;
+                    }
+                }
+            }
+            updates++;
+        }
+
+        secs = (now_ns() - start) / 1e9;
+        printf("%-9s %-5u %-11.0f %-14.0f %.0f\n", batched ? "batched" : "per-line",
+               bus->num, updates / secs, updates * bus->num / secs,
+               (bus->ioctls - ioctls) / secs);
+    }
+
+    /* Outputs read back what was driven, on gpio-sim as on the SoC */
+    if (gpio_lines_get(bus, mask, &got) < 0)
+    {
+        return -1;
+    }
+    if (got != bits)
+    {
+        printf("readback mismatch: drove 0x%llx, read 0x%llx\n",
+               (unsigned long long)bits, (unsigned long long)got);
+        return -1;
+    }
+    printf("readback  0x%llx ok\n", (unsigned long long)got);
+    return 0;
+}
+
+static int edge_toggle(struct edge_source *src)
+{
+    static const char *pulls[] = { "pull-down", "pull-up" };
+
+    src->level ^= 1;
+    if (src->pull_fd >= 0)
+    {
+        const char *s = pulls[src->level];
+
+        return (pwrite(src->pull_fd, s, strlen(s), 0) < 0) ? -1 : 0;
+    }
+    return gpio_lines_set(&src->out, src->level, 1);
+}
+
+/*
+ * Generates a burst of edges, then drains them reading at most @batch
+ * events per read(). The kernel stamps each edge in its IRQ handler, so the
+ * interval between consecutive timestamps is what the hardware saw however
+ * late userspace gets to the queue.
+ */
+static int bench_events(struct gpio_lines *in, struct edge_source *src, unsigned int burst,
+                        unsigned int batch)
+{
+    static struct gpio_v2_line_event ev[MAX_EVENTS];
+    uint64_t start, first_ts = 0, last_ts = 0, gap, gap_min = UINT64_MAX, gap_max = 0;
+    uint32_t last_seq = 0;
+    unsigned int got = 0, reads = 0, lost = 0, i;
+    struct pollfd pfd = { .fd = in->fd, .events = POLLIN };
+    int n;
+
+    start = now_ns();
+    for (i = 0; i < burst; i++)
+    {
+        if (edge_toggle(src) < 0)
+        {
+            return -1;
+        }
+    }
+
+    while (got + lost < burst && poll(&pfd, 1, 100) > 0)
+    {
+        n = gpio_lines_read_events(in, ev, batch);
+        if (n < 0)
+        {
+            return -1;
+        }
+        reads++;
+
+        for (i = 0; i < (unsigned int)n; i++)
+        {
+            if (got && ev[i].seqno != last_seq + 1)
+            {
+                lost += ev[i].seqno - last_seq - 1;
+            }
+            if (got)
+            {
+                gap = ev[i].timestamp_ns - last_ts;
+                gap_min = (gap < gap_min) ? gap : gap_min;
+                gap_max = (gap > gap_max) ? gap : gap_max;
+            }
+            else
+            {
+                first_ts = ev[i].timestamp_ns;
+            }
+            last_seq = ev[i].seqno;
+            last_ts = ev[i].timestamp_ns;
+            got++;
+        }
+    }
+
+    if (got < 2)
+    {
+        printf("%-5u %-5u no edges seen, check the loopback wire\n", burst, batch);
+        return 0;
+    }
+
+    printf("%-5u %-5u %-6u %-5u %-7.1f %-11.0f %-11.0f %-9llu %-9llu %llu\n",
+           burst, batch, got, lost, (double)got / reads,
+           got / ((now_ns() - start) / 1e9),
+           (got - 1) / ((last_ts - first_ts) / 1e9),
+           (unsigned long long)gap_min, (unsigned long long)(last_ts - first_ts) / (got - 1),
+           (unsigned long long)gap_max);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const unsigned int batches[] = { 1, 16, MAX_EVENTS };
+    unsigned int offsets[GPIO_V2_LINES_MAX];
+    const char *chip = GPIO_CHIP;
+    const char *pull = NULL;
+    struct gpio_lines bus, in;
+    struct edge_source src = { .pull_fd = -1 };
+    unsigned int out_line = 0, in_line = 0, burst = 256, chip_lines;
+    int num = 0, have_in = 0, have_out = 0, chip_fd, ret = 0;
+    double secs = 1.0;
+    size_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:l:o:i:P:n:s:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            chip = optarg;
+            break;
+        case 'l':
+            num = parse_offsets(optarg, offsets);
+            break;
+        case 'o':
+            out_line = strtoul(optarg, NULL, 0);
+            have_out = 1;
+            break;
+        case 'i':
+            in_line = strtoul(optarg, NULL, 0);
+            have_in = 1;
+            break;
+        case 'P':
+            pull = optarg;
+            break;
+        case 'n':
+            burst = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            secs = atof(optarg);
+            break;
+        default:
+            num = -1;
+            break;
+        }
+    }
+    if (num < 0 || (!num && !have_in) || (have_in && !have_out && !pull) ||
+        !burst || burst > MAX_EVENTS)
+    {
+        fprintf(stderr, "Usage: %s [-c chip] [-l out,lines,...] [-s seconds]\n"
+                        "          [-i in_line (-o out_line | -P sim_pull_file)] [-n burst <= %d]\n",
+                argv[0], MAX_EVENTS);
+        return 1;
+    }
+
+    chip_fd = gpio_chip_open(chip);
+    if (chip_fd < 0 || gpio_chip_lines(chip_fd, &chip_lines) < 0)
+    {
+        perror("Failed to open GPIO chip");
+        return 1;
+    }
+    printf("Benchmarking %s (%u lines)\n", chip, chip_lines);
+
+    if (num)
+    {
+        if (gpio_lines_request(&bus, chip_fd, offsets, num, GPIO_V2_LINE_FLAG_OUTPUT, 0,
+                               "gpio_bench") < 0)
+        {
+            perror("Failed to request output lines");
+            return 1;
+        }
+        ret = bench_toggle(&bus, secs);
+        gpio_lines_release(&bus);
+    }
+
+    if (!ret && have_in)
+    {
+        /* Kernel FIFO sized for a whole burst, so only read batching varies */
+        if (gpio_lines_request(&in, chip_fd, &in_line, 1,
+                               GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING |
+                               GPIO_V2_LINE_FLAG_EDGE_FALLING, burst, "gpio_bench") < 0)
+        {
+            perror("Failed to request input line");
+            return 1;
+        }
+        fcntl(in.fd, F_SETFL, fcntl(in.fd, F_GETFL) | O_NONBLOCK);
+
+        if (pull)
+        {
+            src.pull_fd = open(pull, O_WRONLY | O_CLOEXEC);
+            if (src.pull_fd < 0)
+            {
+                perror("Failed to open gpio-sim pull attribute");
+                return 1;
+            }
+        }
+        else if (gpio_lines_request(&src.out, chip_fd, &out_line, 1, GPIO_V2_LINE_FLAG_OUTPUT,
+                                    0, "gpio_bench") < 0)
+        {
+            perror("Failed to request edge source line");
+            return 1;
+        }
+
+        printf("burst batch events lost  ev/read ev/s_user   ev/s_kernel gap_min   gap_avg   gap_max_ns\n");
+        for (i = 0; !ret && i < sizeof(batches) / sizeof(batches[0]); i++)
+        {
+            ret = bench_events(&in, &src, burst, batches[i]);
+            fflush(stdout);
+        }
+
+        if (src.pull_fd >= 0)
+        {
+            close(src.pull_fd);
+        }
+        else
+        {
+            gpio_lines_release(&src.out);
+        }
+        gpio_lines_release(&in);
+    }
+
+    if (ret)
+    {
+        perror("Benchmark failed");
+    }
+    close(chip_fd);
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+
+#include "gpio_lib.h"
+
+int gpio_chip_open(const char *path)
+{
+    return open(path, O_RDWR | O_CLOEXEC);
+}
+
+int gpio_chip_lines(int chip_fd, unsigned int *num_lines)
+{
+    struct gpiochip_info info;
+
+    memset(&info, 0, sizeof(info));
+    if (ioctl(chip_fd, GPIO_GET_CHIPINFO_IOCTL, &info) < 0)
+    {
+        return -1;
+    }
+    *num_lines = info.lines;
+    return 0;
+}
+
+/*
+ * @flags applies to every line (GPIO_V2_LINE_FLAG_OUTPUT, _INPUT | _EDGE_*,
+ * ...). @event_buffer_size is the kernel side event FIFO, 0 leaves the
+ * default of 16 per line; make it large enough for a whole burst so reads
+ * can drain it in batches without the kernel dropping events.
+ */
+int gpio_lines_request(struct gpio_lines *lines, int chip_fd, const unsigned int *offsets,
+                       unsigned int num, uint64_t flags, unsigned int event_buffer_size,
+                       const char *consumer)
+{
+    struct gpio_v2_line_request req;
+
+    if (!num || num > GPIO_V2_LINES_MAX)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&req, 0, sizeof(req));
+    memcpy(req.offsets, offsets, num * sizeof(offsets[0]));
+    req.num_lines = num;
+    req.config.flags = flags;
+    req.event_buffer_size = event_buffer_size;
+    snprintf(req.consumer, sizeof(req.consumer), "%s", consumer);
+
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0)
+    {
+        return -1;
+    }
+
+    memset(lines, 0, sizeof(*lines));
+    lines->fd = req.fd;
+    lines->num = num;
+    memcpy(lines->offsets, offsets, num * sizeof(offsets[0]));
+    return 0;
+}
+
+void gpio_lines_release(struct gpio_lines *lines)
+{
+    if (lines->fd >= 0)
+    {
+        close(lines->fd);
+    }
+    lines->fd = -1;
+}
+
+/* Bit position of chip line @offset in this request, -1 if not requested */
+int gpio_lines_index(const struct gpio_lines *lines, unsigned int offset)
+{
+    unsigned int i;
+
+    for (i = 0; i < lines->num; i++)
+    {
+        if (lines->offsets[i] == offset)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint64_t gpio_lines_mask(const struct gpio_lines *lines)
+{
+    return (lines->num == 64) ? ~0ULL : (1ULL << lines->num) - 1;
+}
+
+/* Drives every line selected in @mask to its bit in @bits, in one ioctl */
+int gpio_lines_set(struct gpio_lines *lines, uint64_t bits, uint64_t mask)
+{
+    struct gpio_v2_line_values vals = { .bits = bits, .mask = mask };
+
+    lines->ioctls++;
+    return ioctl(lines->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &vals);
+}
+
+int gpio_lines_get(struct gpio_lines *lines, uint64_t mask, uint64_t *bits)
+{
+    struct gpio_v2_line_values vals = { .bits = 0, .mask = mask };
+
+    lines->ioctls++;
+    if (ioctl(lines->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &vals) < 0)
+    {
+        return -1;
+    }
+    *bits = vals.bits;
+    return 0;
+}
+
+/*
+ * Drains up to @max queued edge events with a single read(). Returns the
+ * number read, 0 if the request was opened non-blocking and nothing was
+ * queued. Each event carries the kernel timestamp and sequence numbers,
+ * a gap in seqno means the kernel FIFO overflowed.
+ */
+int gpio_lines_read_events(struct gpio_lines *lines, struct gpio_v2_line_event *events,
+                           unsigned int max)
+{
+    ssize_t n = read(lines->fd, events, max * sizeof(events[0]));
+
+    if (n < 0)
+    {
+        return (errno == EAGAIN) ? 0 : -1;
+    }
+    return (int)(n / sizeof(events[0]));
+}
@@ -0,0 +1,37 @@
+#ifndef GPIO_LIB_H
+#define GPIO_LIB_H
+
+#include <stdint.h>
+#include <linux/gpio.h>
+
+/*
+ * Thin layer over the GPIO character device v2 ABI. One request holds up to
+ * GPIO_V2_LINES_MAX lines of a chip; values are bitmaps indexed by the
+ * position of the line in the request, not by its chip offset, so a whole
+ * bus is written or sampled with a single ioctl.
+ */
+struct gpio_lines
+{
+    int fd;
+    unsigned int num;
+    unsigned int offsets[GPIO_V2_LINES_MAX];
+    unsigned long ioctls;
+};
+
+int gpio_chip_open(const char *path);
+int gpio_chip_lines(int chip_fd, unsigned int *num_lines);
+
+int gpio_lines_request(struct gpio_lines *lines, int chip_fd, const unsigned int *offsets,
+                       unsigned int num, uint64_t flags, unsigned int event_buffer_size,
+                       const char *consumer);
+void gpio_lines_release(struct gpio_lines *lines);
+
+int gpio_lines_index(const struct gpio_lines *lines, unsigned int offset);
+uint64_t gpio_lines_mask(const struct gpio_lines *lines);
+
+int gpio_lines_set(struct gpio_lines *lines, uint64_t bits, uint64_t mask);
+int gpio_lines_get(struct gpio_lines *lines, uint64_t mask, uint64_t *bits);
+int gpio_lines_read_events(struct gpio_lines *lines, struct gpio_v2_line_event *events,
+                           unsigned int max);
+
+#endif
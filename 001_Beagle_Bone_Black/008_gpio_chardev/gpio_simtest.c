@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+
+#include "gpio_lib.h"
+
+/*
+ * Functional checks of gpio_lib against a gpio-sim chip, where every line
+ * can be observed and driven from sysfs without any wiring:
+ *   - outputs written one line at a time and as a batch read back what was
+ *     driven, through the request and through gpio-sim's sim_gpioN/value;
+ *   - edges made by flipping an input's simulated pull arrive once each,
+ *     with consecutive seqnos and timestamps in order.
+ * Exits non-zero if any check fails.
+ */
+
+#define BUS_LINES 8
+#define MAX_EVENTS 1024
+
+static unsigned int failures;
+
+#define CHECK(cond, ...)                  \
+    do                                    \
+    {                                     \
+        if (!(cond))                      \
+        {                                 \
+            printf("FAIL: " __VA_ARGS__); \
+            printf("\n");                 \
+            failures++;                   \
+        }                                 \
+    } while (0)
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* gpio-sim's view of line @offset: the driven value, -1 on error */
+static int sim_value(const char *sim_dir, unsigned int offset)
+{
+    char path[256], buf[4];
+    ssize_t n;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/sim_gpio%u/value", sim_dir, offset);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0)
+    {
+        return -1;
+    }
+    return buf[0] == '1';
+}
+
+static int sim_set_pull(const char *sim_dir, unsigned int offset, int up)
+{
+    const char *s = up ? "pull-up" : "pull-down";
+    char path[256];
+    int fd, ret;
+
+    snprintf(path, sizeof(path), "%s/sim_gpio%u/pull", sim_dir, offset);
+    fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    ret = (write(fd, s, strlen(s)) < 0) ? -1 : 0;
+    close(fd);
+    return ret;
+}
+
+/* The request and gpio-sim both report @bits on the bus */
+static void check_bus(struct gpio_lines *bus, const char *sim_dir, uint64_t bits,
+                      const char *what)
+{
+    uint64_t got = 0;
+    unsigned int i;
+    int v;
+
+    CHECK(gpio_lines_get(bus, gpio_lines_mask(bus), &got) == 0, "%s: get: %s", what,
+          strerror(errno));
+    CHECK(got == bits, "%s: drove 0x%02llx, read back 0x%02llx", what,
+          (unsigned long long)bits, (unsigned long long)got);
+
+    for (i = 0; i < bus->num; i++)
+    {
+        v = sim_value(sim_dir, bus->offsets[i]);
+        CHECK(v == (int)((bits >> i) & 1), "%s: sim_gpio%u is %d, expected %d", what,
+              bus->offsets[i], v, (int)((bits >> i) & 1));
+    }
+}
+
+/* Every line raised and lowered on its own, the others must hold */
+static void test_per_line(struct gpio_lines *bus, const char *sim_dir)
+{
+    uint64_t bits = 0;
+    unsigned int i;
+    int pass;
+    char what[32];
+
+    CHECK(gpio_lines_set(bus, 0, gpio_lines_mask(bus)) == 0, "per-line: clear: %s",
+          strerror(errno));
+    check_bus(bus, sim_dir, 0, "per-line clear");
+
+    for (pass = 1; pass >= 0; pass--)
+    {
+        for (i = 0; i < bus->num; i++)
+        {
+            bits = pass ? bits | (1ULL << i) : bits & ~(1ULL << i);
+            CHECK(gpio_lines_set(bus, pass ? ~0ULL : 0, 1ULL << i) == 0,
+                  "per-line: set line %u: %s", i, strerror(errno));
+            snprintf(what, sizeof(what), "per-line %s %u", pass ? "set" : "clear", i);
+            check_bus(bus, sim_dir, bits, what);
+        }
+    }
+}
+
+/* Whole-bus and partial writes, one ioctl each, only masked lines change */
+static void test_batched(struct gpio_lines *bus, const char *sim_dir, unsigned int writes)
+{
+    uint64_t all = gpio_lines_mask(bus), bits = 0, values, mask;
+    uint32_t rnd = 0x12345678;
+    unsigned int i;
+    char what[32];
+
+    for (i = 0; i < writes; i++)
+    {
+        rnd = rnd * 1103515245 + 12345;
+        values = rnd >> 8;
+        mask = (i & 1) ? all : (rnd >> 20) & all;
+
+        CHECK(gpio_lines_set(bus, values, mask) == 0, "batched: write %u: %s", i,
+              strerror(errno));
+        bits = (bits & ~mask) | (values & mask);
+        snprintf(what, sizeof(what), "batched write %u", i);
+        check_bus(bus, sim_dir, bits, what);
+        if (failures)
+        {
+            return;
+        }
+    }
+}
+
+/*
+ * @burst edges from flipping the pull of @offset, which starts pulled
+ * down. gpio-sim masks the line while gpiolib's IRQ thread runs, so each
+ * edge is waited for before the next one is made. Each must be reported
+ * once: rising and falling alternate, seqno and line_seqno count up from
+ * 1 without gaps, and the timestamps are in order and inside the window
+ * the edges were made in.
+ */
+static void test_events(int chip_fd, const char *sim_dir, unsigned int offset,
+                        unsigned int burst)
+{
+    static struct gpio_v2_line_event ev[MAX_EVENTS];
+    struct gpio_lines in;
+    struct pollfd pfd;
+    uint64_t start, end, last_ts = 0, level = 0;
+    unsigned int got = 0, i;
+    int n;
+
+    CHECK(sim_set_pull(sim_dir, offset, 0) == 0, "events: pull-down: %s", strerror(errno));
+    if (gpio_lines_request(&in, chip_fd, &offset, 1,
+                           GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING |
+                           GPIO_V2_LINE_FLAG_EDGE_FALLING, burst, "gpio_simtest") < 0)
+    {
+        CHECK(0, "events: request line %u: %s", offset, strerror(errno));
+        return;
+    }
+    fcntl(in.fd, F_SETFL, fcntl(in.fd, F_GETFL) | O_NONBLOCK);
+
+    pfd.fd = in.fd;
+    pfd.events = POLLIN;
+    start = now_ns();
+    for (i = 0; i < burst && got == i; i++)
+    {
+        if (sim_set_pull(sim_dir, offset, !(i & 1)) < 0)
+        {
+            CHECK(0, "events: pull: %s", strerror(errno));
+            break;
+        }
+        if (poll(&pfd, 1, 1000) <= 0)
+        {
+            CHECK(0, "events: no event for edge %u", i);
+            break;
+        }
+        n = gpio_lines_read_events(&in, ev + got, MAX_EVENTS - got);
+        if (n < 0)
+        {
+            CHECK(0, "events: read: %s", strerror(errno));
+            break;
+        }
+        got += n;
+    }
+    end = now_ns();
+
+    /* Nothing beyond the burst may be queued */
+    n = gpio_lines_read_events(&in, ev + got, MAX_EVENTS - got);
+    CHECK(n == 0, "events: %d extra events after the burst", n);
+    CHECK(got == burst, "events: made %u edges, got %u", burst, got);
+
+    for (i = 0; i < got; i++)
+    {
+        CHECK(ev[i].offset == offset, "event %u: offset %u", i, ev[i].offset);
+        CHECK(ev[i].id == ((i & 1) ? GPIO_V2_LINE_EVENT_FALLING_EDGE :
+                                     GPIO_V2_LINE_EVENT_RISING_EDGE),
+              "event %u: id %u", i, ev[i].id);
+        CHECK(ev[i].seqno == i + 1, "event %u: seqno %u", i, ev[i].seqno);
+        CHECK(ev[i].line_seqno == i + 1, "event %u: line_seqno %u", i, ev[i].line_seqno);
+        CHECK(ev[i].timestamp_ns >= start && ev[i].timestamp_ns <= end,
+              "event %u: timestamp %llu outside %llu..%llu", i,
+              (unsigned long long)ev[i].timestamp_ns, (unsigned long long)start,
+              (unsigned long long)end);
+        CHECK(ev[i].timestamp_ns >= last_ts, "event %u: timestamp %llu before %llu", i,
+              (unsigned long long)ev[i].timestamp_ns, (unsigned long long)last_ts);
+        last_ts = ev[i].timestamp_ns;
+        if (failures)
+        {
+            break;
+        }
+    }
+
+    /* The line ends where the last edge left it */
+    CHECK(gpio_lines_get(&in, 1, &level) == 0 && level == (burst & 1),
+          "events: input reads %llu, expected %u", (unsigned long long)level, burst & 1);
+    gpio_lines_release(&in);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int offsets[BUS_LINES];
+    const char *chip = NULL, *sim_dir = NULL;
+    unsigned int in_line = BUS_LINES, burst = 256, writes = 1024, chip_lines, i;
+    struct gpio_lines bus;
+    int chip_fd, opt;
+
+    while ((opt = getopt(argc, argv, "c:d:i:n:w:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            chip = optarg;
+            break;
+        case 'd':
+            sim_dir = optarg;
+            break;
+        case 'i':
+            in_line = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            burst = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            writes = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            chip = NULL;
+            break;
+        }
+    }
+    if (!chip || !sim_dir || in_line < BUS_LINES || !burst || burst > MAX_EVENTS)
+    {
+        fprintf(stderr, "Usage: %s -c /dev/gpiochipN -d /sys/devices/platform/gpio-sim.N/gpiochipN\n"
+                        "          [-i in_line >= %d] [-n burst <= %d] [-w writes]\n",
+                argv[0], BUS_LINES, MAX_EVENTS);
+        return 2;
+    }
+
+    chip_fd = gpio_chip_open(chip);
+    if (chip_fd < 0 || gpio_chip_lines(chip_fd, &chip_lines) < 0)
+    {
+        perror("Failed to open GPIO chip");
+        return 2;
+    }
+    if (chip_lines <= in_line)
+    {
+        fprintf(stderr, "%s has %u lines, need %u\n", chip, chip_lines, in_line + 1);
+        return 2;
+    }
+
+    /* Lines 0-7 as the bus, in reverse so request bits differ from offsets */
+    for (i = 0; i < BUS_LINES; i++)
+    {
+        offsets[i] = BUS_LINES - 1 - i;
+    }
+    if (gpio_lines_request(&bus, chip_fd, offsets, BUS_LINES, GPIO_V2_LINE_FLAG_OUTPUT, 0,
+                           "gpio_simtest") < 0)
+    {
+        perror("Failed to request output lines");
+        return 2;
+    }
+
+    test_per_line(&bus, sim_dir);
+    printf("%-8s %s\n", "per-line", failures ? "FAIL" : "ok");
+    if (!failures)
+    {
+        test_batched(&bus, sim_dir, writes);
+        printf("%-8s %s\n", "batched", failures ? "FAIL" : "ok");
+    }
+    gpio_lines_release(&bus);
+
+    if (!failures)
+    {
+        test_events(chip_fd, sim_dir, in_line, burst);
+        printf("%-8s %s\n", "events", failures ? "FAIL" : "ok");
+    }
+
+    close(chip_fd);
+    printf("%s\n", failures ? "FAIL" : "pass");
+    return failures ? 1 : 0;
+}
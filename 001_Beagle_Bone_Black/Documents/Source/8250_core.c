@@ -13,6 +13,7 @@
  */
 
 #include <linux/acpi.h>
+#include <linux/debugfs.h>
 #include <linux/hashtable.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
@@ -34,6 +35,8 @@
 #include <linux/string_helpers.h>
 #include <linux/uaccess.h>
 #include <linux/io.h>
+#include <linux/irq.h>
+#include <linux/seq_file.h>
 
 #include <asm/irq.h>
 
@@ -44,8 +47,17 @@
 struct irq_info {
 	struct			hlist_node node;
 	int			irq;
+	bool			level;	/* One pass is enough to deassert */
 	spinlock_t		lock;	/* Protects list not the hash */
 	struct list_head	*head;
+
+	/* Dispatch statistics, protected by lock */
+	u64			irqs;
+	u64			passes;
+	u64			polls;	/* port->handle_irq() calls */
+	u64			unhandled;
+	unsigned int		max_passes;
+	struct dentry		*debugfs;
 };
 
 #define IRQ_HASH_BITS		5	/* Can be adjusted later */
@@ -56,6 +68,12 @@ static bool skip_txen_test;
 module_param(skip_txen_test, bool, 0644);
 MODULE_PARM_DESC(skip_txen_test, "Skip checking for the TXEN bug at init time");
 
+static bool shared_irq_fast;
+module_param(shared_irq_fast, bool, 0644);
+MODULE_PARM_DESC(shared_irq_fast, "Service the last active port first on shared IRQs, single pass when level triggered");
+
+static struct dentry *serial8250_irq_debugfs;
+
 /*
  * This is the serial driver's interrupt routine.
  *
@@ -73,8 +91,10 @@ MODULE_PARM_DESC(skip_txen_test, "Skip checking for the TXEN bug at init time");
 static irqreturn_t serial8250_interrupt(int irq, void *dev_id)
 {
 	struct irq_info *i = dev_id;
-	struct list_head *l, *end = NULL;
+	struct list_head *l, *end = NULL, *hot = NULL;
+	bool fast = READ_ONCE(shared_irq_fast);
 	int pass_counter = 0, handled = 0;
+	unsigned int passes = 0;
 
 	guard(spinlock)(&i->lock);
 
@@ -83,21 +103,73 @@ static irqreturn_t serial8250_interrupt(int irq, void *dev_id)
 		struct uart_8250_port *up = list_entry(l, struct uart_8250_port, list);
 		struct uart_port *port = &up->port;
 
+		if (l == i->head)
+			passes++;
+		i->polls++;
 		if (port->handle_irq(port)) {
 			handled = 1;
 			end = NULL;
+			if (!hot)
+				hot = l;
 		} else if (end == NULL)
 			end = l;
 
 		l = l->next;
 
-		if (l == i->head && pass_counter++ > PASS_LIMIT)
-			break;
+		if (l == i->head) {
+			/*
+			 * A level triggered line is still asserted if a port
+			 * raised it again meanwhile, so the idle confirmation
+			 * pass only buys extra IIR reads.
+			 */
+			if (fast && i->level && handled)
+				break;
+			if (pass_counter++ > PASS_LIMIT)
+				break;
+		}
 	} while (l != end);
 
+	i->irqs++;
+	i->passes += passes;
+	i->max_passes = max(i->max_passes, passes);
+	if (!handled)
+		i->unhandled++;
+
+	/* Busy ports tend to stay busy, start with this one next time */
+	if (fast && hot)
+		i->head = hot;
+
 	return IRQ_RETVAL(handled);
 }
 
+static int serial8250_irq_stats_show(struct seq_file *s, void *unused)
+{
+	struct irq_info *i = s->private;
+	struct list_head *l;
+	unsigned int ports = 0;
+
+	guard(spinlock_irq)(&i->lock);
+
+	if (i->head) {
+		ports = 1;
+		list_for_each(l, i->head)
+			ports++;
+	}
+
+	seq_printf(s, "ports:           %u\n", ports);
+	seq_printf(s, "level:           %u\n", i->level);
+	seq_printf(s, "irqs:            %llu\n", i->irqs);
+	seq_printf(s, "unhandled:       %llu\n", i->unhandled);
+	seq_printf(s, "passes_x100:     %llu\n",
+		   i->irqs ? div64_u64(i->passes * 100, i->irqs) : 0);
+	seq_printf(s, "polls_x100:      %llu\n",
+		   i->irqs ? div64_u64(i->polls * 100, i->irqs) : 0);
+	seq_printf(s, "max_passes:      %u\n", i->max_passes);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(serial8250_irq_stats);
+
 /*
  * To support ISA shared interrupts, we need to have one interrupt
  * handler that ensures that the IRQ line has been deasserted
@@ -120,8 +192,13 @@ static void serial_do_unlink(struct irq_info *i, struct uart_8250_port *up)
 	spin_unlock_irq(&i->lock);
 	/* List empty so throw away the hash node */
 	if (i->head == NULL) {
+		debugfs_remove(i->debugfs);
 		hlist_del(&i->node);
 		kfree(i);
+		if (hash_empty(irq_lists)) {
+			debugfs_remove(serial8250_irq_debugfs);
+			serial8250_irq_debugfs = NULL;
+		}
 	}
 }
 
@@ -133,6 +210,7 @@ static void serial_do_unlink(struct irq_info *i, struct uart_8250_port *up)
 static struct irq_info *serial_get_or_create_irq_info(const struct uart_8250_port *up)
 {
 	struct irq_info *i;
+	char name[12];
 
 	guard(mutex)(&hash_mutex);
 
@@ -148,6 +226,12 @@ static struct irq_info *serial_get_or_create_irq_info(const struct uart_8250_por
 	i->irq = up->port.irq;
 	hash_add(irq_lists, &i->node, i->irq);
 
+	if (!serial8250_irq_debugfs)
+		serial8250_irq_debugfs = debugfs_create_dir("serial8250_irq", NULL);
+	snprintf(name, sizeof(name), "%d", i->irq);
+	i->debugfs = debugfs_create_file(name, 0444, serial8250_irq_debugfs, i,
+					 &serial8250_irq_stats_fops);
+
 	return i;
 }
 
@@ -172,10 +256,15 @@ static int serial_link_irq_chain(struct uart_8250_port *up)
 	}
 
 	ret = request_irq(up->port.irq, serial8250_interrupt, up->port.irqflags, up->port.name, i);
-	if (ret < 0)
+	if (ret < 0) {
 		serial_do_unlink(i, up);
+		return ret;
+	}
 
-	return ret;
+	/* The trigger type is only settled once the IRQ is requested */
+	WRITE_ONCE(i->level, irq_get_trigger_type(up->port.irq) & IRQ_TYPE_LEVEL_MASK);
+
+	return 0;
 }
 
 static void serial_unlink_irq_chain(struct uart_8250_port *up)
@@ -390,12 +479,35 @@ void __init serial8250_register_ports(struct uart_driver *drv, struct device *de
 
 #ifdef CONFIG_SERIAL_8250_CONSOLE
 
-static void univ8250_console_write(struct console *co, const char *s,
-				   unsigned int count)
+static void univ8250_console_write_atomic(struct console *co,
+					  struct nbcon_write_context *wctxt)
+{
+	struct uart_8250_port *up = &serial8250_ports[co->index];
+
+	serial8250_console_write_nbcon(up, wctxt, true);
+}
+
+static void univ8250_console_write_thread(struct console *co,
+					  struct nbcon_write_context *wctxt)
 {
 	struct uart_8250_port *up = &serial8250_ports[co->index];
 
-	serial8250_console_write(up, s, count);
+	serial8250_console_write_nbcon(up, wctxt, false);
+}
+
+/* Serializes the printing kthread against everything else using the port */
+static void univ8250_console_device_lock(struct console *co, unsigned long *flags)
+{
+	struct uart_port *port = &serial8250_ports[co->index].port;
+
+	__uart_port_lock_irqsave(port, flags);
+}
+
+static void univ8250_console_device_unlock(struct console *co, unsigned long flags)
+{
+	struct uart_port *port = &serial8250_ports[co->index].port;
+
+	__uart_port_unlock_irqrestore(port, flags);
 }
 
 static int univ8250_console_setup(struct console *co, char *options)
@@ -496,12 +608,15 @@ static int univ8250_console_match(struct console *co, char *name, int idx,
 
 static struct console univ8250_console = {
 	.name		= "ttyS",
-	.write		= univ8250_console_write,
+	.write_atomic	= univ8250_console_write_atomic,
+	.write_thread	= univ8250_console_write_thread,
+	.device_lock	= univ8250_console_device_lock,
+	.device_unlock	= univ8250_console_device_unlock,
 	.device		= uart_console_device,
 	.setup		= univ8250_console_setup,
 	.exit		= univ8250_console_exit,
 	.match		= univ8250_console_match,
-	.flags		= CON_PRINTBUFFER | CON_ANYTIME,
+	.flags		= CON_PRINTBUFFER | CON_ANYTIME | CON_NBCON,
 	.index		= -1,
 	.data		= &serial8250_reg,
 };
@@ -29,6 +29,15 @@
 #include <linux/sys_soc.h>
 #include <linux/reboot.h>
 #include <linux/pinctrl/consumer.h>
+#include <linux/miscdevice.h>
+#include <linux/uaccess.h>
+#include <linux/poll.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/log2.h>
+#include <linux/hrtimer.h>
+#include <linux/iopoll.h>
+#include <linux/jump_label.h>
 
 #include "8250.h"
 
@@ -91,6 +100,39 @@
 #define TX_TRIGGER	1
 #define RX_TRIGGER	48
 
+/*
+ * Adaptive RX trigger (PIO only). The interrupt rate and average burst are
+ * sampled over a window; a busy port whose interrupts mostly fire at the
+ * trigger level steps up, a quiet port steps back down for latency.
+ */
+#define RX_TRIG_WINDOW_MS	100
+#define RX_TRIG_HIGH_IRQ_RATE	2000
+#define RX_TRIG_LOW_IRQ_RATE	200
+
+/*
+ * RX polling (PIO only). Once rx_poll_irqs RX interrupts land within the
+ * window the RX interrupts are masked and an hrtimer drains the FIFO every
+ * RX_POLL_CHARS character times. A poll that finds fewer than
+ * RX_POLL_EXIT_CHARS means the burst is over and interrupts come back.
+ */
+#define RX_POLL_WINDOW_MS	10
+#define RX_POLL_CHARS		32
+#define RX_POLL_EXIT_CHARS	8
+
+/* Cyclic RX DMA ring: periods of N trigger-sized bursts */
+#define RX_DMA_CYCLIC_BURSTS	16
+#define RX_DMA_CYCLIC_PERIODS	8
+
+/* Default for the largest baud rate error the divisor solver accepts, 2% */
+#define OMAP8250_BAUD_TOL_PPM	20000
+
+/* Timestamp records queued for the raw reader, merged when it falls behind */
+#define OMAP8250_RX_STAMPS	64
+
+/* Limits for the DT/sysfs RX DMA buffer configuration */
+#define RX_DMA_MAX_SIZE		SZ_64K
+#define RX_DMA_MAX_BUFS		4
+
 #define OMAP_UART_TCR_RESTORE(x)	((x / 4) << 4)
 #define OMAP_UART_TCR_HALT(x)		((x / 4) << 0)
 
@@ -116,10 +158,86 @@
 /* RX FIFO occupancy indicator */
 #define UART_OMAP_RX_LVL		0x19
 
+/* Special character (XOFF2) match, needs EFR_SCD and EFR_ECB for the IER bit */
+#define OMAP_UART_IER_XOFF		BIT(5)
+#define OMAP_UART_IIR_XOFF		0x10
+
 /* Timeout low and High */
 #define UART_OMAP_TO_L                 0x26
 #define UART_OMAP_TO_H                 0x27
 
+/* log2 buckets: bytes per RX event up to 4K+, IRQ handler time up to ~1ms+ */
+#define OMAP8250_RX_HIST	13
+#define OMAP8250_IRQ_HIST	21
+
+struct omap8250_stats {
+	u64 since_ns;
+	u64 irqs;
+	u64 irqs_timed;
+	u64 irq_ns;
+	u64 irq_ns_max;
+	u64 rx_events;
+	u64 rx_pio_bytes;
+	u64 rx_dma_bytes;
+	u64 tx_pio_bytes;
+	u64 tx_dma_bytes;
+	u64 rx_poll_entries;
+	u64 rx_polls;
+	u64 rx_poll_bytes;
+	u64 rx_delim_irqs;
+	u64 rx_stamp_src[3];
+	u64 rx_stamp_merges;
+	u64 rx_stamp_lag_ns_max;
+	u64 wake_io;
+	u64 wake_rpm;
+	u64 wake_ns;
+	u64 wake_ns_max;
+	u64 mmio_reads;
+	u64 mmio_writes;
+	u32 rx_hist[OMAP8250_RX_HIST];
+	u32 irq_hist[OMAP8250_IRQ_HIST];
+};
+
+struct omap8250_model;
+
+/*
+ * Record header returned by the raw device in stamped mode, followed by
+ * @len data bytes. @ns is CLOCK_MONOTONIC of the event that found the
+ * bytes in the ring: the UART interrupt entry (delimiter or timeout), the
+ * DMA period callback or, when nothing else noticed them, the reader's own
+ * poll. The bytes arrived at or before @ns.
+ */
+enum {
+	OMAP8250_STAMP_IRQ,
+	OMAP8250_STAMP_DMA,
+	OMAP8250_STAMP_POLL,
+};
+
+struct omap8250_rx_stamp {
+	u64 ns;
+	u32 len;
+	u32 src;
+};
+
+/*
+ * What omap8250_restore_regs() last programmed, so set_termios can write
+ * just the registers that differ. Only valid while the port is up and the
+ * context has not been lost.
+ */
+struct omap8250_shadow {
+	bool valid;
+	u16 quot;
+	u8 mdr1;
+	u8 lcr;
+	u8 fcr;
+	u8 tlr;
+	u8 scr;
+	u8 efr;
+	u8 xon;
+	u8 xoff;
+	u8 xoff2;
+};
+
 struct omap8250_priv {
 	void __iomem *membase;
 	int line;
@@ -131,25 +249,81 @@ struct omap8250_priv {
 	u8 wer;
 	u8 xon;
 	u8 xoff;
+	u8 xoff2;
 	u8 delayed_restore;
 	u16 quot;
+	struct omap8250_shadow hw;
+	u32 baud_req;
+	u32 baud_actual;
+	s32 baud_ppm;
+	u32 baud_tol_ppm;
 
 	u8 tx_trigger;
 	u8 rx_trigger;
+	u8 rx_trig_fixed;
+	bool rx_trig_adaptive;
+	s16 rx_delim;
+	unsigned int rx_trig_irqs;
+	unsigned int rx_trig_bytes;
+	unsigned long rx_trig_window;
+	unsigned int rx_poll_irqs;
+	unsigned int rx_poll_count;
+	u64 rx_poll_window;
+	bool rx_polling;
+	ktime_t rx_poll_period;
+	struct hrtimer rx_poll_timer;
+	struct hrtimer em485_temt_timer;
+	bool em485_temt_pending;
+	bool em485_toggle_ier;
 	atomic_t active;
 	bool is_suspending;
 	int wakeirq;
 	u32 latency;
 	u32 calc_latency;
+	u32 latency_target;
+	u64 wake_ns_peak;
+	s32 resume_latency;
+	struct dev_pm_qos_request resume_qos;
 	struct pm_qos_request pm_qos_request;
 	struct work_struct qos_work;
 	struct uart_8250_dma omap8250_dma;
 	spinlock_t rx_dma_lock;
 	bool rx_dma_broken;
+	bool rx_dma_cyclic;
+	u32 rx_dma_period;
+	u32 rx_dma_tail;
+	u32 rx_dma_head;
+	u32 rx_dma_buf_size;
+	u8 rx_dma_nbufs;
+	u8 rx_dma_slot;
+	u64 rx_dma_completions;
+	u64 rx_dma_flushes;
+	u64 rx_dma_bytes;
+
+	/* Raw reader of the cyclic ring, bypasses the tty layer */
+	bool rx_dma_raw;
+	bool rx_raw_active;
+	u32 rx_raw_avail;
+	u32 rx_raw_gen;
+	unsigned long rx_raw_busy;
+	struct mutex rx_raw_lock;
+	wait_queue_head_t rx_raw_wait;
+	struct miscdevice rx_raw_mdev;
 	bool throttled;
 
+	/* Stamped raw mode, sum of the queued record lengths is rx_raw_avail */
+	bool rx_raw_stamped;
+	u32 rx_stamp_head;
+	u32 rx_stamp_tail;
+	u64 irq_start_ns;
+	struct omap8250_rx_stamp rx_stamps[OMAP8250_RX_STAMPS];
+
 	struct pinctrl *pinctrl;
 	struct pinctrl_state *pinctrl_wakeup;
+
+	struct omap8250_stats stats;
+	struct dentry *debugfs;
+	struct omap8250_model __rcu *model;
 };
 
 struct omap8250_dma_params {
@@ -169,6 +343,43 @@ static void omap_8250_rx_dma_flush(struct uart_8250_port *p);
 static inline void omap_8250_rx_dma_flush(struct uart_8250_port *p) { }
 #endif
 
+static struct dentry *omap8250_debugfs_root;
+
+/* Handler timing costs two clock reads per IRQ, debugfs irq_timing turns it on */
+static DEFINE_STATIC_KEY_FALSE(omap8250_irq_timing);
+
+static void omap8250_stats_rx(struct omap8250_priv *priv, unsigned int bytes,
+			      bool dma)
+{
+	if (!bytes)
+		return;
+
+	priv->stats.rx_events++;
+	if (dma)
+		priv->stats.rx_dma_bytes += bytes;
+	else
+		priv->stats.rx_pio_bytes += bytes;
+	priv->stats.rx_hist[min(ilog2(bytes), OMAP8250_RX_HIST - 1)]++;
+}
+
+static void omap8250_stats_irq(struct omap8250_priv *priv, u64 ns)
+{
+	priv->stats.irqs_timed++;
+	priv->stats.irq_ns += ns;
+	priv->stats.irq_ns_max = max(priv->stats.irq_ns_max, ns);
+	priv->stats.irq_hist[min(ilog2(ns | 1), OMAP8250_IRQ_HIST - 1)]++;
+}
+
+/* The FIFO fill time at the current baud, or a tighter application budget */
+static u32 omap8250_qos_latency(struct omap8250_priv *priv)
+{
+	u32 target = READ_ONCE(priv->latency_target);
+
+	if (target && target < priv->calc_latency)
+		return target;
+	return priv->calc_latency;
+}
+
 static u32 uart_read(struct omap8250_priv *priv, u32 reg)
 {
 	return readl(priv->membase + (reg << OMAP_UART_REGSHIFT));
@@ -199,6 +410,7 @@ static void __omap8250_set_mctrl(struct uart_port *port, unsigned int mctrl)
 			priv->efr &= ~UART_EFR_RTS;
 		serial_out(up, UART_EFR, priv->efr);
 		serial_out(up, UART_LCR, lcr);
+		priv->hw.efr = priv->efr;
 	}
 }
 
@@ -234,12 +446,60 @@ static void omap_8250_mdr1_errataset(struct uart_8250_port *up,
 			UART_FCR_CLEAR_RCVR);
 }
 
+/* Error of uartclk / (mode * quot) against @baud, in ppm */
+static s32 omap8250_baud_ppm(unsigned int uartclk, unsigned int mode,
+			     unsigned int quot, unsigned int baud)
+{
+	s64 ideal = (s64)baud * mode * quot;
+
+	return div64_s64(((s64)uartclk - ideal) * 1000000, ideal);
+}
+
+/*
+ * For a given oversampling mode the achieved rate falls monotonically with
+ * the divisor, so the closest rate is at the floor or the ceiling of
+ * uartclk / (mode * baud). Trying both in each mode covers every valid
+ * divisor; on a tie 16x wins for its finer sampling of the bit.
+ */
+static s32 omap8250_solve_divisor(unsigned int uartclk, unsigned int baud,
+				  u8 *mdr1, u16 *quot)
+{
+	static const struct {
+		u8 mode;
+		u8 mdr1;
+	} modes[] = {
+		{ 16, UART_OMAP_MDR1_16X_MODE },
+		{ 13, UART_OMAP_MDR1_13X_MODE },
+	};
+	s32 best = S32_MAX;
+	unsigned int i, d, div;
+	s32 ppm;
+
+	for (i = 0; i < ARRAY_SIZE(modes); i++) {
+		div = uartclk / (modes[i].mode * baud);
+
+		for (d = div; d <= div + 1; d++) {
+			if (!d || d > UART_DIV_MAX)
+				continue;
+
+			ppm = omap8250_baud_ppm(uartclk, modes[i].mode, d, baud);
+			if (abs(ppm) >= abs(best))
+				continue;
+
+			best = ppm;
+			*mdr1 = modes[i].mdr1;
+			*quot = d;
+		}
+	}
+
+	return best;
+}
+
 static void omap_8250_get_divisor(struct uart_port *port, unsigned int baud,
 				  struct omap8250_priv *priv)
 {
 	unsigned int uartclk = port->uartclk;
-	unsigned int div_13, div_16;
-	unsigned int abs_d13, abs_d16;
+	unsigned int mode;
 
 	/*
 	 * Old custom speed handling.
@@ -255,26 +515,20 @@ static void omap_8250_get_divisor(struct uart_port *port, unsigned int baud,
 			priv->mdr1 = UART_OMAP_MDR1_13X_MODE;
 		else
 			priv->mdr1 = UART_OMAP_MDR1_16X_MODE;
+		if (!priv->quot)
+			priv->quot = 1;
+
+		/* The divisor is the request here, there is no error to speak of */
+		mode = priv->mdr1 == UART_OMAP_MDR1_13X_MODE ? 13 : 16;
+		priv->baud_actual = DIV_ROUND_CLOSEST(uartclk, mode * priv->quot);
+		priv->baud_ppm = 0;
 		return;
 	}
-	div_13 = DIV_ROUND_CLOSEST(uartclk, 13 * baud);
-	div_16 = DIV_ROUND_CLOSEST(uartclk, 16 * baud);
-
-	if (!div_13)
-		div_13 = 1;
-	if (!div_16)
-		div_16 = 1;
-
-	abs_d13 = abs(baud - uartclk / 13 / div_13);
-	abs_d16 = abs(baud - uartclk / 16 / div_16);
 
-	if (abs_d13 >= abs_d16) {
-		priv->mdr1 = UART_OMAP_MDR1_16X_MODE;
-		priv->quot = div_16;
-	} else {
-		priv->mdr1 = UART_OMAP_MDR1_13X_MODE;
-		priv->quot = div_13;
-	}
+	priv->baud_ppm = omap8250_solve_divisor(uartclk, baud, &priv->mdr1,
+						&priv->quot);
+	mode = priv->mdr1 == UART_OMAP_MDR1_13X_MODE ? 13 : 16;
+	priv->baud_actual = DIV_ROUND_CLOSEST(uartclk, mode * priv->quot);
 }
 
 static void omap8250_update_scr(struct uart_8250_port *up,
@@ -306,6 +560,30 @@ static void omap8250_update_mdr1(struct uart_8250_port *up,
 		serial_out(up, UART_OMAP_MDR1, priv->mdr1);
 }
 
+static u8 omap8250_tlr(struct omap8250_priv *priv)
+{
+	return TRIGGER_TLR_MASK(priv->tx_trigger) << UART_TI752_TLR_TX |
+	       TRIGGER_TLR_MASK(priv->rx_trigger) << UART_TI752_TLR_RX;
+}
+
+static void omap8250_save_shadow(struct uart_8250_port *up,
+				 struct omap8250_priv *priv)
+{
+	priv->hw = (struct omap8250_shadow) {
+		.valid	= true,
+		.quot	= priv->quot,
+		.mdr1	= priv->mdr1,
+		.lcr	= up->lcr,
+		.fcr	= up->fcr,
+		.tlr	= omap8250_tlr(priv),
+		.scr	= priv->scr,
+		.efr	= priv->efr,
+		.xon	= priv->xon,
+		.xoff	= priv->xoff,
+		.xoff2	= priv->xoff2,
+	};
+}
+
 static void omap8250_restore_regs(struct uart_8250_port *up)
 {
 	struct uart_port *port = &up->port;
@@ -340,9 +618,7 @@ static void omap8250_restore_regs(struct uart_8250_port *up)
 
 	serial_out(up, UART_TI752_TCR, OMAP_UART_TCR_RESTORE(16) |
 			OMAP_UART_TCR_HALT(52));
-	serial_out(up, UART_TI752_TLR,
-		   TRIGGER_TLR_MASK(priv->tx_trigger) << UART_TI752_TLR_TX |
-		   TRIGGER_TLR_MASK(priv->rx_trigger) << UART_TI752_TLR_RX);
+	serial_out(up, UART_TI752_TLR, omap8250_tlr(priv));
 
 	serial_out(up, UART_LCR, 0);
 
@@ -360,6 +636,8 @@ static void omap8250_restore_regs(struct uart_8250_port *up)
 	serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
 	serial_out(up, UART_XON1, priv->xon);
 	serial_out(up, UART_XOFF1, priv->xoff);
+	if (priv->efr & UART_EFR_SCD)
+		serial_out(up, UART_XOFF2, priv->xoff2);
 
 	serial_out(up, UART_LCR, up->lcr);
 
@@ -369,9 +647,147 @@ static void omap8250_restore_regs(struct uart_8250_port *up)
 
 	serial_out(up, UART_OMAP_MDR3, priv->mdr3);
 
-	if (port->rs485.flags & SER_RS485_ENABLED &&
-	    port->rs485_config == serial8250_em485_config)
-		serial8250_em485_stop_tx(up, true);
+	omap8250_save_shadow(up, priv);
+
+	if (port->rs485.flags & SER_RS485_ENABLED && up->em485)
+		up->rs485_stop_tx(up, true);
+}
+
+/*
+ * set_termios counterpart of omap8250_restore_regs(): diff the new settings
+ * against the shadow and write only what changed. A new divisor or MDR1
+ * still takes the full path with the MDR1 errata handling, but parity,
+ * word length, stop bits and flow control changes at the same rate skip
+ * it and leave the FIFOs alone.
+ */
+static void omap8250_reprogram_regs(struct uart_8250_port *up, u8 old_ier)
+{
+	struct uart_port *port = &up->port;
+	struct omap8250_priv *priv = port->private_data;
+	struct omap8250_shadow *hw = &priv->hw;
+	struct uart_8250_dma *dma = up->dma;
+	bool lcr_dirty = false;
+	bool efr_dirty;
+	u8 tlr, mcr;
+
+	lockdep_assert_held_once(&port->lock);
+
+	/* The XOFF interrupt enable in IER[5] is only writable with EFR_ECB */
+	if (!hw->valid || hw->quot != priv->quot || hw->mdr1 != priv->mdr1 ||
+	    (hw->efr ^ priv->efr) & UART_EFR_SCD || hw->xoff2 != priv->xoff2 ||
+	    (dma && dma->tx_running)) {
+		omap8250_restore_regs(up);
+		return;
+	}
+
+	/* What __omap8250_set_mctrl() would fold into EFR for autoRTS */
+	if (!mctrl_gpio_to_gpiod(up->gpios, UART_GPIO_RTS)) {
+		if ((port->mctrl & TIOCM_RTS) && (port->status & UPSTAT_AUTORTS))
+			priv->efr |= UART_EFR_RTS;
+		else
+			priv->efr &= ~UART_EFR_RTS;
+	}
+
+	/* IER goes first, while LCR is still in operational mode */
+	if (up->ier != old_ier)
+		serial_out(up, UART_IER, up->ier);
+
+	tlr = omap8250_tlr(priv);
+	efr_dirty = hw->efr != priv->efr;
+	if (hw->fcr != up->fcr || hw->tlr != tlr) {
+		mcr = serial8250_in_MCR(up);
+
+		serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
+		serial_out(up, UART_EFR, UART_EFR_ECB);
+		serial_out(up, UART_LCR, UART_LCR_CONF_MODE_A);
+		serial8250_out_MCR(up, mcr | UART_MCR_TCRTLR);
+		serial_out(up, UART_FCR, up->fcr);
+		serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
+		serial_out(up, UART_TI752_TLR, tlr);
+		serial_out(up, UART_LCR, 0);
+		serial8250_out_MCR(up, mcr);
+
+		efr_dirty = true;
+		lcr_dirty = true;
+	}
+
+	if (hw->scr != priv->scr)
+		omap8250_update_scr(up, priv);
+
+	if (efr_dirty || hw->xon != priv->xon || hw->xoff != priv->xoff) {
+		serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
+		if (hw->xon != priv->xon)
+			serial_out(up, UART_XON1, priv->xon);
+		if (hw->xoff != priv->xoff)
+			serial_out(up, UART_XOFF1, priv->xoff);
+		if (efr_dirty)
+			serial_out(up, UART_EFR, priv->efr);
+		lcr_dirty = true;
+	}
+
+	if (lcr_dirty || hw->lcr != up->lcr)
+		serial_out(up, UART_LCR, up->lcr);
+
+	omap8250_save_shadow(up, priv);
+}
+
+/*
+ * Frame delimiter: the UART compares every received character against
+ * XOFF2 and raises the special character interrupt on a match, which the
+ * RX paths treat like an early RX timeout. The AM654 EFR2 DMA flow has its
+ * own timeout handling and does not take part.
+ */
+static void omap8250_rx_delim_update(struct uart_8250_port *up,
+				     struct omap8250_priv *priv)
+{
+	int delim = READ_ONCE(priv->rx_delim);
+
+	if (up->dma && priv->habit & UART_HAS_EFR2)
+		delim = -1;
+
+	priv->efr &= ~UART_EFR_SCD;
+	up->ier &= ~OMAP_UART_IER_XOFF;
+	if (delim < 0)
+		return;
+
+	priv->xoff2 = delim;
+	priv->efr |= UART_EFR_SCD;
+	up->ier |= OMAP_UART_IER_XOFF;
+}
+
+/*
+ * Delimiter change on a running port: XOFF2 first, then EFR_SCD and
+ * IER[5], which is only writable with EFR_ECB. Unlike a full restore this
+ * leaves MDR1 and the FIFOs alone, so nothing in flight is lost.
+ */
+static void omap8250_rx_delim_write(struct uart_8250_port *up,
+				    struct omap8250_priv *priv)
+{
+	struct omap8250_shadow *hw = &priv->hw;
+	u8 old_ier = up->ier;
+
+	lockdep_assert_held_once(&up->port.lock);
+
+	omap8250_rx_delim_update(up, priv);
+	if (!hw->valid) {
+		omap8250_restore_regs(up);
+		return;
+	}
+
+	/* restore_regs() skips XOFF2 while SCD is off, so hw->xoff2 may not be in the UART */
+	serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
+	if (priv->efr & UART_EFR_SCD)
+		serial_out(up, UART_XOFF2, priv->xoff2);
+	serial_out(up, UART_EFR, priv->efr | UART_EFR_ECB);
+	serial_out(up, UART_LCR, up->lcr);
+	if (up->ier != old_ier)
+		serial_out(up, UART_IER, up->ier);
+	serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
+	serial_out(up, UART_EFR, priv->efr);
+	serial_out(up, UART_LCR, up->lcr);
+
+	hw->efr = priv->efr;
+	hw->xoff2 = priv->xoff2;
 }
 
 static void omap_8250_set_termios_atomic(struct uart_port *port, struct ktermios *termios,
@@ -379,7 +795,7 @@ static void omap_8250_set_termios_atomic(struct uart_port *port, struct ktermios
 {
 	struct uart_8250_port *up = up_to_u8250p(port);
 	struct omap8250_priv *priv = port->private_data;
-	u8 cval;
+	u8 cval, old_ier;
 
 	cval = UART_LCR_WLEN(tty_get_char_size(termios->c_cflag));
 
@@ -443,6 +859,7 @@ static void omap_8250_set_termios_atomic(struct uart_port *port, struct ktermios
 	/*
 	 * Modem status interrupts
 	 */
+	old_ier = up->ier;
 	up->ier &= ~UART_IER_MSI;
 	if (UART_ENABLE_MS(port, termios->c_cflag))
 		up->ier |= UART_IER_MSI;
@@ -506,7 +923,8 @@ static void omap_8250_set_termios_atomic(struct uart_port *port, struct ktermios
 			priv->efr |= OMAP_UART_SW_TX;
 		}
 	}
-	omap8250_restore_regs(up);
+	omap8250_rx_delim_update(up, priv);
+	omap8250_reprogram_regs(up, old_ier);
 }
 
 /*
@@ -519,6 +937,7 @@ static void omap_8250_set_termios(struct uart_port *port,
 {
 	struct omap8250_priv *priv = port->private_data;
 	unsigned int baud;
+	bool spd_cust;
 
 	/*
 	 * Ask the core to calculate the divisor for us.
@@ -526,18 +945,45 @@ static void omap_8250_set_termios(struct uart_port *port,
 	baud = uart_get_baud_rate(port, termios, old,
 				  port->uartclk / 16 / UART_DIV_MAX,
 				  port->uartclk / 13);
+	priv->baud_req = baud;
+	spd_cust = baud == 38400 && (port->flags & UPF_SPD_MASK) == UPF_SPD_CUST;
+
+	/*
+	 * The core only checks the range. A rate that no divisor gets within
+	 * the tolerance would just be garbage on the wire, so keep the old
+	 * rate instead, the way the core handles rates out of range.
+	 */
+	if (!spd_cust) {
+		u32 tol = READ_ONCE(priv->baud_tol_ppm);
+		u8 mdr1;
+		u16 quot;
+		s32 ppm;
+
+		ppm = omap8250_solve_divisor(port->uartclk, baud, &mdr1, &quot);
+		if (abs(ppm) > tol) {
+			dev_warn_ratelimited(port->dev,
+					     "%u baud is %d ppm off, beyond %u ppm\n",
+					     baud, ppm, tol);
+			baud = old ? tty_termios_baud_rate(old) : 0;
+			if (!baud)
+				baud = 9600;
+		}
+	}
 
 	omap_8250_set_termios_atomic(port, termios, old, baud);
 
 	/* calculate wakeup latency constraint */
 	priv->calc_latency = USEC_PER_SEC * 64 * 8 / baud;
-	priv->latency = priv->calc_latency;
+	priv->latency = omap8250_qos_latency(priv);
 
 	schedule_work(&priv->qos_work);
 
-	/* Don't rewrite B0 */
-	if (tty_termios_baud_rate(termios))
+	/* Don't rewrite B0, otherwise report what the divisor really gives */
+	if (tty_termios_baud_rate(termios)) {
+		if (!spd_cust)
+			baud = priv->baud_actual;
 		tty_termios_encode_baud_rate(termios, baud, baud);
+	}
 }
 
 /* same as 8250 except that we may have extra flow bits set in EFR */
@@ -545,6 +991,7 @@ static void omap_8250_pm(struct uart_port *port, unsigned int state,
 			 unsigned int oldstate)
 {
 	struct uart_8250_port *up = up_to_u8250p(port);
+	struct omap8250_priv *priv = port->private_data;
 	u8 efr;
 
 	guard(serial8250_rpm)(up);
@@ -560,6 +1007,9 @@ static void omap_8250_pm(struct uart_port *port, unsigned int state,
 	serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
 	serial_out(up, UART_EFR, efr);
 	serial_out(up, UART_LCR, 0);
+
+	/* LCR is left at 0, the next set_termios has to write everything */
+	priv->hw.valid = false;
 }
 
 static void omap_serial_fill_features_erratas(struct uart_8250_port *up,
@@ -627,116 +1077,1728 @@ static void omap_serial_fill_features_erratas(struct uart_8250_port *up,
 		priv->habit &= ~UART_HAS_RHR_IT_DIS;
 }
 
+/*
+ * The latency target is also the resume latency the port tolerates. Once a
+ * runtime resume has been seen to take longer than that, it would eat the
+ * whole budget on the first byte, so the request drops to 0, which keeps
+ * runtime PM from suspending the port at all. Unlike touching the
+ * autosuspend delay this leaves the user's or serdev driver's setting
+ * alone. Writing the target again starts a new measurement.
+ */
+static void omap8250_update_resume_qos(struct omap8250_priv *priv)
+{
+	u32 target = READ_ONCE(priv->latency_target);
+	s32 value = PM_QOS_RESUME_LATENCY_NO_CONSTRAINT;
+
+	if (target)
+		value = div_u64(READ_ONCE(priv->wake_ns_peak), NSEC_PER_USEC) >=
+			target ? 0 : min_t(u32, target, S32_MAX);
+
+	WRITE_ONCE(priv->resume_latency, value);
+	dev_pm_qos_update_request(&priv->resume_qos, value);
+}
+
 static void omap8250_uart_qos_work(struct work_struct *work)
 {
 	struct omap8250_priv *priv;
 
 	priv = container_of(work, struct omap8250_priv, qos_work);
 	cpu_latency_qos_update_request(&priv->pm_qos_request, priv->latency);
+	omap8250_update_resume_qos(priv);
 }
 
-#ifdef CONFIG_SERIAL_8250_DMA
-static int omap_8250_dma_handle_irq(struct uart_port *port);
-#endif
+static const u8 omap8250_rx_trig_levels[] = { 1, 8, 16, 32, RX_TRIGGER };
 
-static irqreturn_t omap8250_irq(int irq, void *dev_id)
+/*
+ * Reprogram only the RX trigger (FCR[7:6] + TLR[7:4]) without going through
+ * omap8250_restore_regs(), FIFO contents are left untouched.
+ */
+static void omap8250_update_rx_trigger(struct uart_8250_port *up,
+				       struct omap8250_priv *priv)
 {
-	struct omap8250_priv *priv = dev_id;
-	struct uart_8250_port *up = serial8250_get_port(priv->line);
-	struct uart_port *port = &up->port;
-	unsigned int iir, lsr;
-	int ret;
+	u8 mcr;
 
-	pm_runtime_get_noresume(port->dev);
+	/* Port locked to synchronize UART_IER access against the console. */
+	lockdep_assert_held_once(&up->port.lock);
 
-	/* Shallow idle state wake-up to an IO interrupt? */
-	if (atomic_add_unless(&priv->active, 1, 1)) {
-		priv->latency = priv->calc_latency;
-		schedule_work(&priv->qos_work);
-	}
+	/* set_termios() has not run yet, it will pick up priv->rx_trigger */
+	if (!(up->fcr & UART_FCR_ENABLE_FIFO))
+		return;
 
-#ifdef CONFIG_SERIAL_8250_DMA
-	if (up->dma) {
-		ret = omap_8250_dma_handle_irq(port);
-		pm_runtime_mark_last_busy(port->dev);
-		pm_runtime_put(port->dev);
-		return IRQ_RETVAL(ret);
-	}
-#endif
+	up->fcr &= ~UART_FCR_TRIGGER_MASK;
+	up->fcr |= TRIGGER_FCR_MASK(priv->rx_trigger) << OMAP_UART_FCR_RX_TRIG;
 
-	lsr = serial_port_in(port, UART_LSR);
-	iir = serial_port_in(port, UART_IIR);
-	ret = serial8250_handle_irq(port, iir);
+	mcr = serial8250_in_MCR(up);
 
-	/*
-	 * On K3 SoCs, it is observed that RX TIMEOUT is signalled after
-	 * FIFO has been drained or erroneously.
-	 * So apply solution of Errata i2310 as mentioned in
-	 * https://www.ti.com/lit/pdf/sprz536
-	 */
-	if (priv->habit & UART_RX_TIMEOUT_QUIRK &&
-	    (iir & UART_IIR_RX_TIMEOUT) == UART_IIR_RX_TIMEOUT &&
-	    serial_port_in(port, UART_OMAP_RX_LVL) == 0) {
-		unsigned char efr2, timeout_h, timeout_l;
+	serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
+	serial_out(up, UART_EFR, UART_EFR_ECB);
 
-		efr2 = serial_in(up, UART_OMAP_EFR2);
-		timeout_h = serial_in(up, UART_OMAP_TO_H);
-		timeout_l = serial_in(up, UART_OMAP_TO_L);
-		serial_out(up, UART_OMAP_TO_H, 0xFF);
-		serial_out(up, UART_OMAP_TO_L, 0xFF);
-		serial_out(up, UART_OMAP_EFR2, UART_OMAP_EFR2_TIMEOUT_BEHAVE);
-		serial_in(up, UART_IIR);
-		serial_out(up, UART_OMAP_EFR2, efr2);
-		serial_out(up, UART_OMAP_TO_H, timeout_h);
-		serial_out(up, UART_OMAP_TO_L, timeout_l);
-	}
+	serial_out(up, UART_LCR, UART_LCR_CONF_MODE_A);
+	serial8250_out_MCR(up, mcr | UART_MCR_TCRTLR);
+	serial_out(up, UART_FCR, up->fcr);
 
-	/* Stop processing interrupts on input overrun */
-	if ((lsr & UART_LSR_OE) && up->overrun_backoff_time_ms > 0) {
-		unsigned long delay;
+	serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
+	serial_out(up, UART_TI752_TLR, omap8250_tlr(priv));
 
-		/* Synchronize UART_IER access against the console. */
-		uart_port_lock(port);
-		up->ier = serial_port_in(port, UART_IER);
-		if (up->ier & (UART_IER_RLSI | UART_IER_RDI)) {
-			port->ops->stop_rx(port);
-		} else {
-			/* Keep restarting the timer until
-			 * the input overrun subsides.
-			 */
-			cancel_delayed_work(&up->overrun_backoff);
-		}
-		uart_port_unlock(port);
+	serial_out(up, UART_LCR, 0);
+	serial8250_out_MCR(up, mcr);
 
-		delay = msecs_to_jiffies(up->overrun_backoff_time_ms);
-		schedule_delayed_work(&up->overrun_backoff, delay);
-	}
+	serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
+	serial_out(up, UART_EFR, priv->efr);
+	serial_out(up, UART_LCR, up->lcr);
 
-	pm_runtime_mark_last_busy(port->dev);
-	pm_runtime_put(port->dev);
+	priv->hw.fcr = up->fcr;
+	priv->hw.tlr = omap8250_tlr(priv);
+}
 
-	return IRQ_RETVAL(ret);
+static void omap8250_rx_trig_reset_window(struct omap8250_priv *priv)
+{
+	priv->rx_trig_irqs = 0;
+	priv->rx_trig_bytes = 0;
+	priv->rx_trig_window = jiffies;
 }
 
-static int omap_8250_startup(struct uart_port *port)
+static u8 omap8250_rx_trig_step(u8 level, bool raise)
 {
-	struct uart_8250_port *up = up_to_u8250p(port);
-	struct omap8250_priv *priv = port->private_data;
-	struct uart_8250_dma *dma = &priv->omap8250_dma;
-	int ret;
+	int i;
 
-	if (priv->wakeirq) {
-		ret = dev_pm_set_dedicated_wake_irq(port->dev, priv->wakeirq);
-		if (ret)
-			return ret;
-	}
+	for (i = 0; i < ARRAY_SIZE(omap8250_rx_trig_levels); i++)
+		if (omap8250_rx_trig_levels[i] >= level)
+			break;
 
-#ifdef CONFIG_PM
-	up->capabilities |= UART_CAP_RPM;
-#endif
+	if (raise)
+		i = min_t(int, i + 1, ARRAY_SIZE(omap8250_rx_trig_levels) - 1);
+	else
+		i = max(i - 1, 0);
+
+	return omap8250_rx_trig_levels[i];
+}
+
+/* Called from the PIO interrupt path with the bytes that IRQ delivered */
+static void omap8250_rx_trig_account(struct uart_8250_port *up,
+				     struct omap8250_priv *priv,
+				     unsigned int bytes)
+{
+	unsigned long elapsed;
+	unsigned int rate, avg;
+	u8 level;
+
+	if (!bytes)
+		return;
+
+	priv->rx_trig_irqs++;
+	priv->rx_trig_bytes += bytes;
+
+	elapsed = jiffies - priv->rx_trig_window;
+	if (elapsed < msecs_to_jiffies(RX_TRIG_WINDOW_MS))
+		return;
+
+	rate = priv->rx_trig_irqs * HZ / elapsed;
+	avg = priv->rx_trig_bytes / priv->rx_trig_irqs;
+	level = priv->rx_trigger;
+
+	/* Bursts reaching ~3/4 of the trigger mean the FIFO keeps filling up */
+	if (rate >= RX_TRIG_HIGH_IRQ_RATE && avg * 4 >= level * 3)
+		level = omap8250_rx_trig_step(level, true);
+	else if (rate <= RX_TRIG_LOW_IRQ_RATE)
+		level = omap8250_rx_trig_step(level, false);
+
+	omap8250_rx_trig_reset_window(priv);
+
+	if (level == priv->rx_trigger)
+		return;
+
+	guard(uart_port_lock_irqsave)(&up->port);
+	if (!priv->rx_trig_adaptive)
+		return;
+	priv->rx_trigger = level;
+	omap8250_update_rx_trigger(up, priv);
+}
+
+/*
+ * PIO receive. RX_LVL is sampled before LSR, so a clean LSR (no error bits,
+ * FIFOE clear) vouches for every byte counted in it and they can be read
+ * back to back and handed over with one tty_insert_flip_string(). Anything
+ * that needs per-character status (errors, break/sysrq, CREAD off) goes
+ * through serial8250_read_char() as before.
+ *
+ * Each pass ends with the RX_LVL/LSR pair the next pass works from, so a
+ * batch costs two status reads and no LSR value is ever dropped: its
+ * clear-on-read error bits either steer the next pass or stay in
+ * lsr_saved_flags via serial_lsr_in(). The caller's LSR predates the first
+ * RX_LVL sample, so the first pass takes a fresh pair with its bits merged.
+ */
+static u16 omap_8250_rx_chars(struct uart_8250_port *up, u16 lsr)
+{
+	struct uart_port *port = &up->port;
+	struct tty_port *tport = &port->state->port;
+	unsigned char buf[64];
+	int max_count = 256;
+	int lvl, ret, i;
+	int drained = 0;
+
+	lvl = serial_in(up, UART_OMAP_RX_LVL);
+	lsr |= serial_lsr_in(up);
+
+	while (max_count > 0 && (lsr & (UART_LSR_DR | UART_LSR_BI))) {
+		if (unlikely(lsr & (UART_LSR_BRK_ERROR_BITS | UART_LSR_FIFOE) ||
+			     port->ignore_status_mask & UART_LSR_DR ||
+			     port->sysrq || !lvl)) {
+			serial8250_read_char(up, lsr);
+			max_count--;
+			drained++;
+		} else {
+			lvl = min3(lvl, max_count, (int)sizeof(buf));
+			for (i = 0; i < lvl; i++)
+				buf[i] = serial_in(up, UART_RX);
+
+			ret = tty_insert_flip_string(tport, buf, lvl);
+			port->icount.rx += lvl;
+			port->icount.buf_overrun += lvl - ret;
+			max_count -= lvl;
+			drained += lvl;
+		}
+
+		lvl = serial_in(up, UART_OMAP_RX_LVL);
+		lsr = serial_lsr_in(up);
+	}
+
+	omap8250_stats_rx(port->private_data, drained, false);
+	tty_flip_buffer_push(tport);
+	return lsr;
+}
+
+/* serial8250_rpm_put_tx(), for when we clear THRI behind 8250_port's back */
+static void omap8250_rpm_put_tx(struct uart_8250_port *up)
+{
+	if (!(up->capabilities & UART_CAP_RPM))
+		return;
+
+	if (!xchg(&up->rpm_tx_active, 0))
+		return;
+	pm_runtime_mark_last_busy(up->port.dev);
+	pm_runtime_put_autosuspend(up->port.dev);
+}
+
+/*
+ * RS-485 software turnaround for ports without MDR3 direction control.
+ * Once the xmit buffer is empty TX_LVL says how many characters are still
+ * ahead of the shift register, so arm the em485 stop timer for exactly
+ * that long now instead of waiting for THRE and then for TEMT, which has
+ * no interrupt here. Must be called with the port lock held.
+ */
+static bool omap8250_rs485_stop_tx(struct uart_8250_port *up)
+{
+	struct uart_8250_em485 *em485 = up->em485;
+	u32 frame = up->port.frame_time;
+	u64 delay;
+
+	if (!em485 || !frame || em485->active_timer == &em485->start_tx_timer)
+		return false;
+
+	/* FIFO plus shift register, and ~1 bit for THRE leading the stop bit */
+	delay = (u64)(serial_in(up, UART_OMAP_TX_LVL) + 1) * frame +
+		DIV_ROUND_UP(frame, 7);
+	delay += (u64)up->port.rs485.delay_rts_after_send * NSEC_PER_MSEC;
+
+	em485->active_timer = &em485->stop_tx_timer;
+	hrtimer_start(&em485->stop_tx_timer, ns_to_ktime(delay),
+		      HRTIMER_MODE_REL);
+
+	/* The TX runtime PM reference is dropped once RTS is back, see below */
+	serial8250_clear_THRI(up);
+
+	return true;
+}
+
+static void omap8250_em485_finish(struct uart_8250_port *up, bool toggle_ier)
+{
+	serial8250_em485_stop_tx(up, toggle_ier);
+
+	if (!(up->ier & UART_IER_THRI))
+		omap8250_rpm_put_tx(up);
+}
+
+/*
+ * The stop timer is computed to expire right after the last stop bit. If
+ * TEMT says the shift register is still busy, come back once whatever
+ * TX_LVL still counts plus one frame has had time to go out, rather than
+ * truncating the last character on a late estimate. This runs from the
+ * em485 hrtimer, so it re-arms instead of spinning, and only once: the
+ * second expiry drops RTS whatever TEMT says. The port only becomes idle
+ * here, so this is also where the TX runtime PM reference goes; when
+ * 8250_port got here itself its own put is a no-op.
+ */
+static void omap8250_em485_stop_tx(struct uart_8250_port *up, bool toggle_ier)
+{
+	struct omap8250_priv *priv = up->port.private_data;
+	u32 frame = up->port.frame_time;
+	u64 delay;
+
+	if (frame && !priv->em485_temt_pending &&
+	    !(serial_lsr_in(up) & UART_LSR_TEMT)) {
+		delay = (u64)(serial_in(up, UART_OMAP_TX_LVL) + 1) * frame;
+		priv->em485_temt_pending = true;
+		priv->em485_toggle_ier = toggle_ier;
+		hrtimer_start(&priv->em485_temt_timer, ns_to_ktime(delay),
+			      HRTIMER_MODE_REL);
+		return;
+	}
+
+	priv->em485_temt_pending = false;
+	omap8250_em485_finish(up, toggle_ier);
+}
+
+static enum hrtimer_restart omap8250_em485_temt(struct hrtimer *t)
+{
+	struct omap8250_priv *priv = container_of(t, struct omap8250_priv,
+						  em485_temt_timer);
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+
+	guard(serial8250_rpm)(up);
+	guard(uart_port_lock_irqsave)(&up->port);
+
+	if (priv->em485_temt_pending && up->em485)
+		omap8250_em485_stop_tx(up, priv->em485_toggle_ier);
+	priv->em485_temt_pending = false;
+
+	return HRTIMER_NORESTART;
+}
+
+/* A new transmission keeps RTS asserted, so a deferred stop is void */
+static void omap8250_em485_start_tx(struct uart_8250_port *up, bool toggle_ier)
+{
+	struct omap8250_priv *priv = up->port.private_data;
+
+	if (priv->em485_temt_pending) {
+		priv->em485_temt_pending = false;
+		hrtimer_try_to_cancel(&priv->em485_temt_timer);
+	}
+	serial8250_em485_start_tx(up, toggle_ier);
+}
+
+/*
+ * PIO transmit. THRE only says the FIFO went empty at some point, TX_LVL
+ * says how much room there is right now, so fill exactly that much straight
+ * from the linear part of the xmit kfifo. The x_char, stopped and empty
+ * cases, including stopping TX, are left to serial8250_tx_chars().
+ */
+static void omap_8250_tx_chars(struct uart_8250_port *up)
+{
+	struct uart_port *port = &up->port;
+	struct omap8250_priv *priv = port->private_data;
+	struct tty_port *tport = &port->state->port;
+	unsigned int space, len, i;
+	u8 *tail;
+
+	if (port->x_char || uart_tx_stopped(port) ||
+	    kfifo_is_empty(&tport->xmit_fifo)) {
+		serial8250_tx_chars(up);
+		return;
+	}
+
+	space = up->tx_loadsz - serial_in(up, UART_OMAP_TX_LVL);
+	while (space) {
+		len = kfifo_out_linear_ptr(&tport->xmit_fifo, &tail, space);
+		if (!len)
+			break;
+
+		for (i = 0; i < len; i++)
+			serial_out(up, UART_TX, tail[i]);
+
+		uart_xmit_advance(port, len);
+		priv->stats.tx_pio_bytes += len;
+		space -= len;
+	}
+
+	if (kfifo_len(&tport->xmit_fifo) < WAKEUP_CHARS)
+		uart_write_wakeup(port);
+
+	if (!kfifo_is_empty(&tport->xmit_fifo))
+		return;
+
+	if (omap8250_rs485_stop_tx(up))
+		return;
+
+	/* Without RPM serial8250_tx_chars() stops TX as soon as we drain */
+	if (!(up->capabilities & UART_CAP_RPM))
+		serial8250_tx_chars(up);
+}
+
+/* serial8250_handle_irq() for the non-DMA case, with the RX/TX paths above */
+static int omap_8250_pio_handle_irq(struct uart_port *port, unsigned int iir)
+{
+	struct uart_8250_port *up = up_to_u8250p(port);
+	struct tty_port *tport = &port->state->port;
+	bool skip_rx = false;
+	unsigned long flags;
+	u16 status;
+
+	if (iir & UART_IIR_NO_INT)
+		return 0;
+
+	uart_port_lock_irqsave(port, &flags);
+
+	status = serial_lsr_in(up);
+
+	/* See serial8250_handle_irq(), leave the FIFO to auto-RTS */
+	if (!(status & (UART_LSR_FIFOE | UART_LSR_BRK_ERROR_BITS)) &&
+	    (port->status & (UPSTAT_AUTOCTS | UPSTAT_AUTORTS)) &&
+	    !(up->ier & (UART_IER_RLSI | UART_IER_RDI)))
+		skip_rx = true;
+
+	if (status & (UART_LSR_DR | UART_LSR_BI) && !skip_rx) {
+		struct irq_data *d;
+
+		d = irq_get_irq_data(port->irq);
+		if (d && irqd_is_wakeup_set(d))
+			pm_wakeup_event(tport->tty->dev, 0);
+		status = omap_8250_rx_chars(up, status);
+	}
+	serial8250_modem_status(up);
+	if ((status & UART_LSR_THRE) && (up->ier & UART_IER_THRI))
+		omap_8250_tx_chars(up);
+
+	uart_unlock_and_check_sysrq_irqrestore(port, flags);
+
+	return 1;
+}
+
+/* Must be called with the port lock held */
+static void omap8250_rx_poll_start(struct uart_8250_port *up,
+				   struct omap8250_priv *priv)
+{
+	u64 period = (u64)up->port.frame_time * RX_POLL_CHARS;
+
+	if (priv->rx_polling || priv->throttled || priv->is_suspending ||
+	    !period || !(up->ier & UART_IER_RDI))
+		return;
+
+	/* Keep the port awake for as long as the timer owns RX */
+	pm_runtime_get_noresume(up->port.dev);
+	priv->rx_polling = true;
+	priv->stats.rx_poll_entries++;
+
+	up->ier &= ~(UART_IER_RLSI | UART_IER_RDI);
+	serial_out(up, UART_IER, up->ier);
+
+	priv->rx_poll_period = ns_to_ktime(period);
+	hrtimer_start(&priv->rx_poll_timer, priv->rx_poll_period,
+		      HRTIMER_MODE_REL);
+}
+
+/* Called from the PIO interrupt path with the bytes that IRQ delivered */
+static void omap8250_rx_poll_account(struct uart_8250_port *up,
+				     struct omap8250_priv *priv,
+				     unsigned int bytes)
+{
+	u64 now;
+
+	if (!bytes)
+		return;
+
+	now = ktime_get_ns();
+	if (now - priv->rx_poll_window > RX_POLL_WINDOW_MS * NSEC_PER_MSEC) {
+		priv->rx_poll_window = now;
+		priv->rx_poll_count = 0;
+	}
+
+	if (++priv->rx_poll_count < READ_ONCE(priv->rx_poll_irqs))
+		return;
+
+	priv->rx_poll_count = 0;
+	guard(uart_port_lock_irqsave)(&up->port);
+	omap8250_rx_poll_start(up, priv);
+}
+
+static enum hrtimer_restart omap8250_rx_poll(struct hrtimer *t)
+{
+	struct omap8250_priv *priv = container_of(t, struct omap8250_priv,
+						  rx_poll_timer);
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	struct uart_port *port = &up->port;
+	__u32 rx_before = port->icount.rx;
+	unsigned long flags;
+	bool done;
+	u16 lsr;
+
+	uart_port_lock_irqsave(port, &flags);
+
+	if (!priv->rx_polling) {
+		uart_port_unlock_irqrestore(port, flags);
+		return HRTIMER_NORESTART;
+	}
+
+	done = priv->throttled || priv->is_suspending;
+	if (!done) {
+		lsr = serial_lsr_in(up);
+		if (lsr & (UART_LSR_DR | UART_LSR_BI))
+			omap_8250_rx_chars(up, lsr);
+
+		priv->stats.rx_polls++;
+		priv->stats.rx_poll_bytes += port->icount.rx - rx_before;
+		done = port->icount.rx - rx_before < RX_POLL_EXIT_CHARS;
+
+		/* Throttle left IER alone for us, otherwise hand RX back */
+		if (done) {
+			up->ier |= UART_IER_RLSI | UART_IER_RDI;
+			serial_out(up, UART_IER, up->ier);
+		}
+	}
+	if (done)
+		priv->rx_polling = false;
+
+	uart_unlock_and_check_sysrq_irqrestore(port, flags);
+
+	if (done) {
+		pm_runtime_mark_last_busy(port->dev);
+		pm_runtime_put(port->dev);
+		return HRTIMER_NORESTART;
+	}
+
+	hrtimer_forward_now(t, priv->rx_poll_period);
+	return HRTIMER_RESTART;
+}
+
+/* Leaves RX interrupts as they are, the caller decides what IER becomes */
+static void omap8250_rx_poll_stop(struct omap8250_priv *priv,
+				  struct device *dev)
+{
+	hrtimer_cancel(&priv->rx_poll_timer);
+	if (priv->rx_polling) {
+		priv->rx_polling = false;
+		pm_runtime_put_noidle(dev);
+	}
+}
+
+#ifdef CONFIG_SERIAL_8250_DMA
+static int omap_8250_dma_handle_irq(struct uart_port *port);
+#endif
+
+static irqreturn_t __omap8250_irq(struct omap8250_priv *priv)
+{
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	struct uart_port *port = &up->port;
+	unsigned int iir, lsr;
+	__u32 rx_before;
+	int ret;
+
+	pm_runtime_get_noresume(port->dev);
+
+	/* Shallow idle state wake-up to an IO interrupt? */
+	if (atomic_add_unless(&priv->active, 1, 1)) {
+		priv->stats.wake_io++;
+		priv->latency = omap8250_qos_latency(priv);
+		schedule_work(&priv->qos_work);
+	}
+
+#ifdef CONFIG_SERIAL_8250_DMA
+	if (up->dma) {
+		ret = omap_8250_dma_handle_irq(port);
+		pm_runtime_mark_last_busy(port->dev);
+		pm_runtime_put(port->dev);
+		return IRQ_RETVAL(ret);
+	}
+#endif
+
+	lsr = serial_port_in(port, UART_LSR);
+	iir = serial_port_in(port, UART_IIR);
+	if ((iir & 0x3f) == OMAP_UART_IIR_XOFF)
+		priv->stats.rx_delim_irqs++;
+	rx_before = port->icount.rx;
+	ret = omap_8250_pio_handle_irq(port, iir);
+
+	if (READ_ONCE(priv->rx_trig_adaptive))
+		omap8250_rx_trig_account(up, priv, port->icount.rx - rx_before);
+	if (READ_ONCE(priv->rx_poll_irqs))
+		omap8250_rx_poll_account(up, priv, port->icount.rx - rx_before);
+
+	/*
+	 * On K3 SoCs, it is observed that RX TIMEOUT is signalled after
+	 * FIFO has been drained or erroneously.
+	 * So apply solution of Errata i2310 as mentioned in
+	 * https://www.ti.com/lit/pdf/sprz536
+	 */
+	if (priv->habit & UART_RX_TIMEOUT_QUIRK &&
+	    (iir & UART_IIR_RX_TIMEOUT) == UART_IIR_RX_TIMEOUT &&
+	    serial_port_in(port, UART_OMAP_RX_LVL) == 0) {
+		unsigned char efr2, timeout_h, timeout_l;
+
+		efr2 = serial_in(up, UART_OMAP_EFR2);
+		timeout_h = serial_in(up, UART_OMAP_TO_H);
+		timeout_l = serial_in(up, UART_OMAP_TO_L);
+		serial_out(up, UART_OMAP_TO_H, 0xFF);
+		serial_out(up, UART_OMAP_TO_L, 0xFF);
+		serial_out(up, UART_OMAP_EFR2, UART_OMAP_EFR2_TIMEOUT_BEHAVE);
+		serial_in(up, UART_IIR);
+		serial_out(up, UART_OMAP_EFR2, efr2);
+		serial_out(up, UART_OMAP_TO_H, timeout_h);
+		serial_out(up, UART_OMAP_TO_L, timeout_l);
+	}
+
+	/* Stop processing interrupts on input overrun */
+	if ((lsr & UART_LSR_OE) && up->overrun_backoff_time_ms > 0) {
+		unsigned long delay;
+
+		/* Synchronize UART_IER access against the console. */
+		uart_port_lock(port);
+		up->ier = serial_port_in(port, UART_IER);
+		if (up->ier & (UART_IER_RLSI | UART_IER_RDI)) {
+			port->ops->stop_rx(port);
+		} else {
+			/* Keep restarting the timer until
+			 * the input overrun subsides.
+			 */
+			cancel_delayed_work(&up->overrun_backoff);
+		}
+		uart_port_unlock(port);
+
+		delay = msecs_to_jiffies(up->overrun_backoff_time_ms);
+		schedule_delayed_work(&up->overrun_backoff, delay);
+	}
+
+	pm_runtime_mark_last_busy(port->dev);
+	pm_runtime_put(port->dev);
+
+	return IRQ_RETVAL(ret);
+}
+
+static irqreturn_t omap8250_irq(int irq, void *dev_id)
+{
+	struct omap8250_priv *priv = dev_id;
+	irqreturn_t ret;
+	u64 start;
+
+	priv->stats.irqs++;
+	if (!static_branch_unlikely(&omap8250_irq_timing)) {
+		/* Stamped raw records still want the IRQ entry time */
+		if (READ_ONCE(priv->rx_raw_stamped))
+			priv->irq_start_ns = ktime_get_ns();
+		return __omap8250_irq(priv);
+	}
+
+	start = ktime_get_ns();
+	priv->irq_start_ns = start;
+	ret = __omap8250_irq(priv);
+	omap8250_stats_irq(priv, ktime_get_ns() - start);
+
+	return ret;
+}
+
+/*
+ * Software model of the OMAP UART behind the serial_in/serial_out hooks, so
+ * the IRQ, RX and TX paths can be driven and measured without a board. TX
+ * is looped back into RX one character per frame time, with injected
+ * traffic filling the idle frames. It models 64 byte FIFOs, RX_LVL/TX_LVL,
+ * sticky overrun, the RX timeout after four idle character times and the
+ * IIR priorities the driver depends on. TCR and TLR are kept apart from
+ * XOFF1/XOFF2 like the hardware does, but trigger levels come from priv
+ * instead of being decoded from TLR. The real interrupt line is left
+ * alone: a "line" hrtimer calls omap8250_irq() while an interrupt is
+ * pending. It can only be switched while the port is closed.
+ */
+#define OMAP8250_MODEL_FIFO		64
+#define OMAP8250_MODEL_REGS		0x40
+#define OMAP8250_MODEL_TIMEOUT		4
+#define OMAP8250_MODEL_FRAME_NS		(100 * NSEC_PER_USEC)
+#define OMAP8250_MODEL_MIN_TICK_NS	(20 * NSEC_PER_USEC)
+
+struct omap8250_model {
+	raw_spinlock_t lock;
+	struct omap8250_priv *priv;
+	struct uart_port *port;
+	struct hrtimer line;
+	u64 last_ns;
+
+	u8 regs[OMAP8250_MODEL_REGS];
+	u8 dl[2];
+	u8 cfg[8];
+	u8 tcr;
+	u8 tlr;
+	u8 rx[OMAP8250_MODEL_FIFO];
+	u8 tx[OMAP8250_MODEL_FIFO];
+	unsigned int rx_head;
+	unsigned int rx_len;
+	unsigned int tx_head;
+	unsigned int tx_len;
+	unsigned int rx_idle;
+	bool shifting;
+	bool oe;
+	bool sc;
+	u8 shift;
+	u8 last_rx;
+	u8 inject_seq;
+	u32 inject;
+
+	u64 tx_chars;
+	u64 rx_chars;
+	u64 rx_overruns;
+	u64 tx_overflows;
+	u64 irqs;
+
+	/* Port accessors in place before the model was attached */
+	u32 (*serial_in)(struct uart_port *port, unsigned int offset);
+	void (*serial_out)(struct uart_port *port, unsigned int offset,
+			   u32 value);
+};
+
+static u64 omap8250_model_frame_ns(struct omap8250_model *m)
+{
+	return READ_ONCE(m->port->frame_time) ?: OMAP8250_MODEL_FRAME_NS;
+}
+
+static u8 omap8250_model_iir(struct omap8250_model *m)
+{
+	struct omap8250_priv *priv = m->priv;
+	u8 ier = m->regs[UART_IER];
+
+	if (ier & UART_IER_RLSI && m->oe)
+		return UART_IIR_RLSI;
+
+	if (ier & UART_IER_RDI && m->rx_len) {
+		if (!(m->regs[UART_OMAP_IER2] & UART_OMAP_IER2_RHR_IT_DIS) &&
+		    m->rx_len >= max_t(u8, priv->rx_trigger, 1))
+			return UART_IIR_RDI;
+		if (m->rx_idle >= OMAP8250_MODEL_TIMEOUT)
+			return UART_IIR_RX_TIMEOUT;
+	}
+
+	if (ier & UART_IER_THRI) {
+		if (m->regs[UART_OMAP_SCR] & OMAP_UART_SCR_TX_EMPTY ?
+		    !m->tx_len :
+		    OMAP8250_MODEL_FIFO - m->tx_len >= priv->tx_trigger)
+			return UART_IIR_THRI;
+	}
+
+	if (ier & OMAP_UART_IER_XOFF && m->sc)
+		return OMAP_UART_IIR_XOFF;
+
+	return UART_IIR_NO_INT;
+}
+
+/* One character time on the wire: shifter to RX, TX FIFO to shifter */
+static void omap8250_model_frame(struct omap8250_model *m)
+{
+	bool have = false;
+	u8 c = 0;
+
+	if (m->shifting) {
+		c = m->shift;
+		m->shifting = false;
+		m->tx_chars++;
+		have = true;
+	} else if (m->inject) {
+		c = m->inject_seq++;
+		m->inject--;
+		have = true;
+	}
+
+	if (m->tx_len) {
+		m->shift = m->tx[m->tx_head];
+		m->tx_head = (m->tx_head + 1) % OMAP8250_MODEL_FIFO;
+		m->tx_len--;
+		m->shifting = true;
+	}
+
+	if (!have) {
+		if (m->rx_idle < OMAP8250_MODEL_TIMEOUT)
+			m->rx_idle++;
+		return;
+	}
+
+	m->rx_idle = 0;
+	if (m->rx_len == OMAP8250_MODEL_FIFO) {
+		m->oe = true;
+		m->rx_overruns++;
+		return;
+	}
+	m->rx[(m->rx_head + m->rx_len) % OMAP8250_MODEL_FIFO] = c;
+	m->rx_len++;
+	m->rx_chars++;
+
+	if (m->cfg[UART_EFR] & UART_EFR_SCD && c == m->cfg[UART_XOFF2])
+		m->sc = true;
+}
+
+static bool omap8250_model_busy(struct omap8250_model *m)
+{
+	return m->tx_len || m->shifting || m->inject ||
+	       (m->rx_len && m->rx_idle < OMAP8250_MODEL_TIMEOUT) ||
+	       omap8250_model_iir(m) != UART_IIR_NO_INT;
+}
+
+static void omap8250_model_kick(struct omap8250_model *m)
+{
+	u64 period = max_t(u64, omap8250_model_frame_ns(m),
+			   OMAP8250_MODEL_MIN_TICK_NS);
+
+	lockdep_assert_held(&m->lock);
+
+	if (!omap8250_model_busy(m) || hrtimer_is_queued(&m->line))
+		return;
+
+	/* Coming out of idle, the wire starts now and not at the last tick */
+	if (!hrtimer_active(&m->line))
+		m->last_ns = ktime_get_ns();
+	hrtimer_start(&m->line, ns_to_ktime(period), HRTIMER_MODE_REL_HARD);
+}
+
+static enum hrtimer_restart omap8250_model_tick(struct hrtimer *t)
+{
+	struct omap8250_model *m = container_of(t, struct omap8250_model, line);
+	u64 now = ktime_get_ns();
+	unsigned int frames = 0;
+	bool irq;
+
+	scoped_guard(raw_spinlock_irqsave, &m->lock) {
+		u64 frame = omap8250_model_frame_ns(m);
+		bool enabled = (m->regs[UART_OMAP_MDR1] & UART_OMAP_MDR1_DISABLE) !=
+			       UART_OMAP_MDR1_DISABLE;
+
+		while (enabled && now - m->last_ns >= frame &&
+		       frames++ < 2 * OMAP8250_MODEL_FIFO) {
+			omap8250_model_frame(m);
+			m->last_ns += frame;
+		}
+		/* Way behind, drop the backlog instead of replaying it */
+		if (now - m->last_ns >= frame)
+			m->last_ns = now;
+
+		irq = omap8250_model_iir(m) != UART_IIR_NO_INT;
+		if (irq)
+			m->irqs++;
+	}
+
+	if (irq)
+		omap8250_irq(m->port->irq, m->priv);
+
+	scoped_guard(raw_spinlock_irqsave, &m->lock)
+		omap8250_model_kick(m);
+
+	return HRTIMER_NORESTART;
+}
+
+/* Offsets 6 and 7 are TCR and TLR in every mode while EFR[4] and MCR[6] are set */
+static u8 *omap8250_model_tcrtlr(struct omap8250_model *m, unsigned int offset)
+{
+	if (offset != UART_TI752_TCR && offset != UART_TI752_TLR)
+		return NULL;
+	if (!(m->cfg[UART_EFR] & UART_EFR_ECB) ||
+	    !(m->regs[UART_MCR] & UART_MCR_TCRTLR))
+		return NULL;
+	return offset == UART_TI752_TCR ? &m->tcr : &m->tlr;
+}
+
+static u32 omap8250_model_in(struct omap8250_model *m, unsigned int offset)
+{
+	u8 lcr, val, *reg;
+
+	if (offset >= OMAP8250_MODEL_REGS)
+		return 0;
+
+	guard(raw_spinlock_irqsave)(&m->lock);
+	lcr = m->regs[UART_LCR];
+	if (lcr & UART_LCR_DLAB && offset <= UART_DLM)
+		return m->dl[offset];
+	reg = omap8250_model_tcrtlr(m, offset);
+	if (reg)
+		return *reg;
+	if (lcr == UART_LCR_CONF_MODE_B && offset < 8 && offset != UART_LCR)
+		return m->cfg[offset];
+
+	switch (offset) {
+	case UART_RX:
+		if (m->rx_len) {
+			m->last_rx = m->rx[m->rx_head];
+			m->rx_head = (m->rx_head + 1) % OMAP8250_MODEL_FIFO;
+			m->rx_len--;
+			m->rx_idle = 0;
+			omap8250_model_kick(m);
+		}
+		return m->last_rx;
+	case UART_IIR:
+		val = omap8250_model_iir(m);
+		if (val == OMAP_UART_IIR_XOFF)
+			m->sc = false;
+		if (m->regs[UART_FCR] & UART_FCR_ENABLE_FIFO)
+			val |= UART_IIR_FIFO_ENABLED_16550A;
+		return val;
+	case UART_LSR:
+		val = 0;
+		if (m->rx_len)
+			val |= UART_LSR_DR;
+		if (m->oe)
+			val |= UART_LSR_OE;
+		if (!m->tx_len)
+			val |= UART_LSR_THRE;
+		if (!m->tx_len && !m->shifting)
+			val |= UART_LSR_TEMT;
+		m->oe = false;
+		return val;
+	case UART_MSR:
+		return UART_MSR_DCD | UART_MSR_DSR | UART_MSR_CTS;
+	case UART_OMAP_RX_LVL:
+		return m->rx_len;
+	case UART_OMAP_TX_LVL:
+		return m->tx_len;
+	}
+
+	return m->regs[offset];
+}
+
+static void omap8250_model_out(struct omap8250_model *m, unsigned int offset,
+			       u32 value)
+{
+	u8 lcr, *reg;
+
+	if (offset >= OMAP8250_MODEL_REGS)
+		return;
+
+	guard(raw_spinlock_irqsave)(&m->lock);
+	lcr = m->regs[UART_LCR];
+	if (lcr & UART_LCR_DLAB && offset <= UART_DLM) {
+		m->dl[offset] = value;
+		return;
+	}
+	reg = omap8250_model_tcrtlr(m, offset);
+	if (reg) {
+		*reg = value;
+		return;
+	}
+	if (lcr == UART_LCR_CONF_MODE_B && offset < 8 && offset != UART_LCR) {
+		m->cfg[offset] = value;
+		return;
+	}
+
+	switch (offset) {
+	case UART_TX:
+		if (m->tx_len == OMAP8250_MODEL_FIFO) {
+			m->tx_overflows++;
+			break;
+		}
+		m->tx[(m->tx_head + m->tx_len) % OMAP8250_MODEL_FIFO] = value;
+		m->tx_len++;
+		break;
+	case UART_FCR:
+		if (value & UART_FCR_CLEAR_RCVR) {
+			m->rx_len = 0;
+			m->rx_idle = 0;
+		}
+		if (value & UART_FCR_CLEAR_XMIT)
+			m->tx_len = 0;
+		m->regs[UART_FCR] = value & ~(UART_FCR_CLEAR_RCVR |
+					      UART_FCR_CLEAR_XMIT);
+		break;
+	case UART_LSR:
+	case UART_MSR:
+	case UART_OMAP_RX_LVL:
+	case UART_OMAP_TX_LVL:
+		break;
+	default:
+		m->regs[offset] = value;
+		break;
+	}
+
+	omap8250_model_kick(m);
+}
+
+/*
+ * Register accessors, only installed on the port while a model is attached so
+ * a production port keeps the plain 8250 MMIO helpers. Every access is counted
+ * so the cost of a path can be read off the stats as MMIO per byte. The MMIO
+ * fallback only covers the window in which the model is being detached.
+ */
+static u32 omap8250_serial_in(struct uart_port *port, unsigned int offset)
+{
+	struct omap8250_priv *priv = port->private_data;
+	struct omap8250_model *m;
+
+	priv->stats.mmio_reads++;
+
+	scoped_guard(rcu) {
+		m = rcu_dereference(priv->model);
+		if (m)
+			return omap8250_model_in(m, offset);
+	}
+
+	offset <<= port->regshift;
+	if (port->iotype == UPIO_MEM32)
+		return readl(port->membase + offset);
+	return readb(port->membase + offset);
+}
+
+static void omap8250_serial_out(struct uart_port *port, unsigned int offset,
+				u32 value)
+{
+	struct omap8250_priv *priv = port->private_data;
+	struct omap8250_model *m;
+
+	priv->stats.mmio_writes++;
+
+	scoped_guard(rcu) {
+		m = rcu_dereference(priv->model);
+		if (m) {
+			omap8250_model_out(m, offset, value);
+			return;
+		}
+	}
+
+	offset <<= port->regshift;
+	if (port->iotype == UPIO_MEM32)
+		writel(value, port->membase + offset);
+	else
+		writeb(value, port->membase + offset);
+}
+
+static void omap8250_model_free(struct omap8250_priv *priv)
+{
+	struct omap8250_model *m = rcu_replace_pointer(priv->model, NULL, true);
+
+	if (!m)
+		return;
+
+	WRITE_ONCE(m->port->serial_in, m->serial_in);
+	WRITE_ONCE(m->port->serial_out, m->serial_out);
+	synchronize_rcu();
+	hrtimer_cancel(&m->line);
+	kfree(m);
+}
+
+static int omap8250_model_attach(struct omap8250_priv *priv, bool on)
+{
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	struct uart_port *port = &up->port;
+	struct tty_port *tport = &port->state->port;
+	struct omap8250_model *m;
+
+	guard(mutex)(&tport->mutex);
+	if (tty_port_initialized(tport) || uart_console(port))
+		return -EBUSY;
+
+	if (!on) {
+		omap8250_model_free(priv);
+		return 0;
+	}
+
+	if (rcu_access_pointer(priv->model))
+		return 0;
+	/* The DMA engine would still be talking to the real FIFOs */
+	if (priv->omap8250_dma.fn)
+		return -EOPNOTSUPP;
+
+	m = kzalloc(sizeof(*m), GFP_KERNEL);
+	if (!m)
+		return -ENOMEM;
+
+	raw_spin_lock_init(&m->lock);
+	m->priv = priv;
+	m->port = port;
+	hrtimer_setup(&m->line, omap8250_model_tick, CLOCK_MONOTONIC,
+		      HRTIMER_MODE_REL_HARD);
+	m->serial_in = port->serial_in;
+	m->serial_out = port->serial_out;
+	rcu_assign_pointer(priv->model, m);
+	WRITE_ONCE(port->serial_in, omap8250_serial_in);
+	WRITE_ONCE(port->serial_out, omap8250_serial_out);
+
+	return 0;
+}
+
+static void omap8250_seq_hist(struct seq_file *s, const char *title,
+			      const u32 *hist, int buckets)
+{
+	int i;
+
+	seq_printf(s, "%s:\n", title);
+	for (i = 0; i < buckets; i++) {
+		if (!hist[i])
+			continue;
+		if (i == buckets - 1)
+			seq_printf(s, "  >= %-8lu %u\n", 1UL << i, hist[i]);
+		else
+			seq_printf(s, "  %-8lu %u\n", 1UL << i, hist[i]);
+	}
+}
+
+static int omap8250_stats_show(struct seq_file *s, void *unused)
+{
+	struct omap8250_priv *priv = s->private;
+	struct omap8250_stats *st = &priv->stats;
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	u64 elapsed = ktime_get_ns() - st->since_ns;
+	u64 bytes = st->rx_pio_bytes + st->rx_dma_bytes + st->tx_pio_bytes +
+		    st->tx_dma_bytes;
+
+	seq_printf(s, "elapsed_ms:       %llu\n", div_u64(elapsed, NSEC_PER_MSEC));
+	seq_printf(s, "irqs:             %llu\n", st->irqs);
+	seq_printf(s, "irqs_per_sec:     %llu\n",
+		   elapsed ? div64_u64(st->irqs * NSEC_PER_SEC, elapsed) : 0);
+	seq_printf(s, "irqs_timed:       %llu\n", st->irqs_timed);
+	seq_printf(s, "irq_ns_avg:       %llu\n",
+		   st->irqs_timed ? div64_u64(st->irq_ns, st->irqs_timed) : 0);
+	seq_printf(s, "irq_ns_max:       %llu\n", st->irq_ns_max);
+	seq_printf(s, "rx_events:        %llu\n", st->rx_events);
+	seq_printf(s, "rx_pio_bytes:     %llu\n", st->rx_pio_bytes);
+	seq_printf(s, "rx_dma_bytes:     %llu\n", st->rx_dma_bytes);
+	seq_printf(s, "rx_bytes_per_irq: %llu\n",
+		   st->irqs ? div64_u64(st->rx_pio_bytes + st->rx_dma_bytes,
+					st->irqs) : 0);
+	seq_printf(s, "rx_dma_flushes:   %llu\n", priv->rx_dma_flushes);
+	seq_printf(s, "tx_pio_bytes:     %llu\n", st->tx_pio_bytes);
+	seq_printf(s, "tx_dma_bytes:     %llu\n", st->tx_dma_bytes);
+	seq_printf(s, "overrun:          %u\n", up->port.icount.overrun);
+	seq_printf(s, "buf_overrun:      %u\n", up->port.icount.buf_overrun);
+	seq_printf(s, "rx_trigger:       %u\n", priv->rx_trigger);
+	seq_printf(s, "rx_polling:       %u\n", priv->rx_polling);
+	seq_printf(s, "rx_poll_entries:  %llu\n", st->rx_poll_entries);
+	seq_printf(s, "rx_polls:         %llu\n", st->rx_polls);
+	seq_printf(s, "rx_poll_bytes:    %llu\n", st->rx_poll_bytes);
+	seq_printf(s, "rx_delim_irqs:    %llu\n", st->rx_delim_irqs);
+	seq_printf(s, "rx_stamps:        irq %llu dma %llu poll %llu\n",
+		   st->rx_stamp_src[OMAP8250_STAMP_IRQ],
+		   st->rx_stamp_src[OMAP8250_STAMP_DMA],
+		   st->rx_stamp_src[OMAP8250_STAMP_POLL]);
+	seq_printf(s, "rx_stamp_merges:  %llu\n", st->rx_stamp_merges);
+	seq_printf(s, "rx_stamp_lag_max: %llu\n", st->rx_stamp_lag_ns_max);
+	seq_printf(s, "wake_io:          %llu\n", st->wake_io);
+	seq_printf(s, "wake_rpm:         %llu\n", st->wake_rpm);
+	seq_printf(s, "wake_ns_avg:      %llu\n",
+		   st->wake_rpm ? div64_u64(st->wake_ns, st->wake_rpm) : 0);
+	seq_printf(s, "wake_ns_max:      %llu\n", st->wake_ns_max);
+	seq_printf(s, "qos_latency_us:   %u\n", priv->latency);
+	seq_printf(s, "resume_qos_us:    %d\n", READ_ONCE(priv->resume_latency));
+	/* MMIO is only counted while the model is attached */
+	seq_printf(s, "mmio_reads:       %llu\n", st->mmio_reads);
+	seq_printf(s, "mmio_writes:      %llu\n", st->mmio_writes);
+	seq_printf(s, "mmio_per_kbyte:   %llu\n",
+		   bytes ? div64_u64((st->mmio_reads + st->mmio_writes) * 1000,
+				     bytes) : 0);
+	seq_printf(s, "irqs_per_kbyte:   %llu\n",
+		   bytes ? div64_u64(st->irqs * 1000, bytes) : 0);
+
+	omap8250_seq_hist(s, "rx_bytes_per_event", st->rx_hist,
+			  OMAP8250_RX_HIST);
+	omap8250_seq_hist(s, "irq_ns", st->irq_hist, OMAP8250_IRQ_HIST);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(omap8250_stats);
+
+static ssize_t omap8250_stats_reset_write(struct file *file,
+					  const char __user *buf,
+					  size_t count, loff_t *ppos)
+{
+	struct omap8250_priv *priv = file->private_data;
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+
+	guard(uart_port_lock_irqsave)(&up->port);
+	memset(&priv->stats, 0, sizeof(priv->stats));
+	priv->stats.since_ns = ktime_get_ns();
+	priv->rx_dma_flushes = 0;
+
+	return count;
+}
+
+static const struct file_operations omap8250_stats_reset_fops = {
+	.open	= simple_open,
+	.write	= omap8250_stats_reset_write,
+};
+
+static ssize_t omap8250_irq_timing_read(struct file *file, char __user *buf,
+					size_t count, loff_t *ppos)
+{
+	char val[2] = { static_key_enabled(&omap8250_irq_timing) ? '1' : '0',
+			'\n' };
+
+	return simple_read_from_buffer(buf, count, ppos, val, sizeof(val));
+}
+
+/* Global, so turning it on affects every port's irq_ns figures from then on */
+static ssize_t omap8250_irq_timing_write(struct file *file,
+					 const char __user *buf,
+					 size_t count, loff_t *ppos)
+{
+	bool on;
+	int ret;
+
+	ret = kstrtobool_from_user(buf, count, &on);
+	if (ret)
+		return ret;
+
+	if (on)
+		static_branch_enable(&omap8250_irq_timing);
+	else
+		static_branch_disable(&omap8250_irq_timing);
+
+	return count;
+}
+
+static const struct file_operations omap8250_irq_timing_fops = {
+	.open	= simple_open,
+	.read	= omap8250_irq_timing_read,
+	.write	= omap8250_irq_timing_write,
+};
+
+static int omap8250_model_show(struct seq_file *s, void *unused)
+{
+	struct omap8250_priv *priv = s->private;
+	struct omap8250_model *m;
+
+	guard(rcu)();
+	m = rcu_dereference(priv->model);
+	seq_printf(s, "enabled:        %u\n", !!m);
+	if (!m)
+		return 0;
+
+	guard(raw_spinlock_irqsave)(&m->lock);
+	seq_printf(s, "frame_ns:       %llu\n", omap8250_model_frame_ns(m));
+	seq_printf(s, "rx_lvl:         %u\n", m->rx_len);
+	seq_printf(s, "tx_lvl:         %u\n", m->tx_len);
+	seq_printf(s, "iir:            0x%02x\n", omap8250_model_iir(m));
+	seq_printf(s, "tx_chars:       %llu\n", m->tx_chars);
+	seq_printf(s, "rx_chars:       %llu\n", m->rx_chars);
+	seq_printf(s, "rx_overruns:    %llu\n", m->rx_overruns);
+	seq_printf(s, "tx_overflows:   %llu\n", m->tx_overflows);
+	seq_printf(s, "irqs:           %llu\n", m->irqs);
+	seq_printf(s, "inject_pending: %u\n", m->inject);
+	return 0;
+}
+
+static int omap8250_model_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap8250_model_show, inode->i_private);
+}
+
+/* "1"/"0" attaches or detaches the model, "inject <n>" queues RX traffic */
+static ssize_t omap8250_model_write(struct file *file, const char __user *ubuf,
+				    size_t count, loff_t *ppos)
+{
+	struct omap8250_priv *priv = ((struct seq_file *)file->private_data)->private;
+	struct omap8250_model *m;
+	char buf[32], *arg;
+	bool on;
+	u32 n;
+	int ret;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+	arg = strim(buf);
+
+	if (!kstrtobool(arg, &on)) {
+		ret = omap8250_model_attach(priv, on);
+		return ret ? ret : count;
+	}
+
+	if (strncmp(arg, "inject ", 7) || kstrtou32(arg + 7, 0, &n))
+		return -EINVAL;
+
+	guard(rcu)();
+	m = rcu_dereference(priv->model);
+	if (!m)
+		return -ENODEV;
+
+	guard(raw_spinlock_irqsave)(&m->lock);
+	m->inject += n;
+	omap8250_model_kick(m);
+
+	return count;
+}
+
+static const struct file_operations omap8250_model_fops = {
+	.open		= omap8250_model_open,
+	.read		= seq_read,
+	.write		= omap8250_model_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void omap8250_debugfs_init(struct omap8250_priv *priv)
+{
+	char name[16];
+
+	priv->stats.since_ns = ktime_get_ns();
+
+	snprintf(name, sizeof(name), "ttyS%d", priv->line);
+	priv->debugfs = debugfs_create_dir(name, omap8250_debugfs_root);
+	debugfs_create_file("stats", 0444, priv->debugfs, priv,
+			    &omap8250_stats_fops);
+	debugfs_create_file("reset", 0200, priv->debugfs, priv,
+			    &omap8250_stats_reset_fops);
+	debugfs_create_file("model", 0600, priv->debugfs, priv,
+			    &omap8250_model_fops);
+}
+
+/*
+ * RX DMA buffer geometry. All buffers come out of one coherent allocation
+ * made by serial8250_request_dma() at startup, so it can only change while
+ * the port is closed.
+ */
+static int omap8250_rx_dma_check(struct omap8250_priv *priv, u32 size,
+				 u32 nbufs)
+{
+	u32 align = priv->omap8250_dma.rxconf.src_maxburst;
+
+	if (priv->rx_dma_cyclic)
+		align *= RX_DMA_CYCLIC_PERIODS;
+
+	if (!size || !align || size % align)
+		return -EINVAL;
+	if (!nbufs || nbufs > RX_DMA_MAX_BUFS || size * nbufs > RX_DMA_MAX_SIZE)
+		return -EINVAL;
+
+	/* The ring is already one buffer, AM654 re-arms from its IRQ handler */
+	if (nbufs > 1 && (priv->rx_dma_cyclic || priv->habit & UART_HAS_EFR2))
+		return -EINVAL;
+
+	return 0;
+}
+
+static void omap8250_rx_dma_setup(struct omap8250_priv *priv)
+{
+	struct uart_8250_dma *dma = &priv->omap8250_dma;
+
+	dma->rx_size = priv->rx_dma_buf_size * priv->rx_dma_nbufs;
+	priv->rx_dma_period = priv->rx_dma_buf_size / RX_DMA_CYCLIC_PERIODS;
+	priv->rx_dma_slot = 0;
+}
+
+static ssize_t rx_trig_policy_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%s\n",
+			  priv->rx_trig_adaptive ? "adaptive" : "fixed");
+}
+
+static ssize_t rx_trig_policy_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	bool adaptive;
+
+	if (sysfs_streq(buf, "adaptive"))
+		adaptive = true;
+	else if (sysfs_streq(buf, "fixed"))
+		adaptive = false;
+	else
+		return -EINVAL;
+
+	/* With DMA the trigger level is also the DMA burst size */
+	if (adaptive && priv->omap8250_dma.fn)
+		return -EOPNOTSUPP;
+
+	guard(serial8250_rpm)(up);
+	guard(uart_port_lock_irqsave)(&up->port);
+
+	omap8250_rx_trig_reset_window(priv);
+	WRITE_ONCE(priv->rx_trig_adaptive, adaptive);
+	if (!adaptive && priv->rx_trigger != priv->rx_trig_fixed) {
+		priv->rx_trigger = priv->rx_trig_fixed;
+		omap8250_update_rx_trigger(up, priv);
+	}
+
+	return count;
+}
+static DEVICE_ATTR_RW(rx_trig_policy);
+
+static ssize_t rx_trig_level_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", priv->rx_trigger);
+}
+
+static ssize_t rx_trig_level_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	u8 level;
+	int ret;
+
+	ret = kstrtou8(buf, 0, &level);
+	if (ret)
+		return ret;
+	if (!level || level > RX_TRIGGER)
+		return -EINVAL;
+	if (priv->omap8250_dma.fn)
+		return -EOPNOTSUPP;
 
 	guard(serial8250_rpm)(up);
+	guard(uart_port_lock_irqsave)(&up->port);
 
+	/* The adaptive policy owns the level, only the fixed one is settable */
+	if (priv->rx_trig_adaptive)
+		return -EBUSY;
+
+	priv->rx_trig_fixed = level;
+	priv->rx_trigger = level;
+	omap8250_update_rx_trigger(up, priv);
+
+	return count;
+}
+static DEVICE_ATTR_RW(rx_trig_level);
+
+static ssize_t rx_poll_irqs_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(priv->rx_poll_irqs));
+}
+
+/* RX interrupts per RX_POLL_WINDOW_MS that switch to polling, 0 disables */
+static ssize_t rx_poll_irqs_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+	unsigned int irqs;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &irqs);
+	if (ret)
+		return ret;
+	/* DMA already batches RX, there is nothing left to poll */
+	if (irqs && priv->omap8250_dma.fn)
+		return -EOPNOTSUPP;
+
+	/* An active poll ends by itself once the burst is over */
+	WRITE_ONCE(priv->rx_poll_irqs, irqs);
+
+	return count;
+}
+static DEVICE_ATTR_RW(rx_poll_irqs);
+
+static ssize_t latency_target_us_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(priv->latency_target));
+}
+
+/* First byte latency budget in usecs, 0 leaves it to the baud rate */
+static ssize_t latency_target_us_store(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+	u32 target;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &target);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(priv->latency_target, target);
+	WRITE_ONCE(priv->wake_ns_peak, 0);
+
+	/* Only tighten the request while awake, suspend drops it anyway */
+	if (atomic_read(&priv->active))
+		priv->latency = omap8250_qos_latency(priv);
+	schedule_work(&priv->qos_work);
+
+	return count;
+}
+static DEVICE_ATTR_RW(latency_target_us);
+
+static ssize_t rx_delimiter_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+	int delim = READ_ONCE(priv->rx_delim);
+
+	if (delim < 0)
+		return sysfs_emit(buf, "none\n");
+	return sysfs_emit(buf, "0x%02x\n", delim);
+}
+
+/* Character that ends a frame and pushes RX right away, "none" disables */
+static ssize_t rx_delimiter_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	u8 delim;
+	int ret;
+
+	if (sysfs_streq(buf, "none")) {
+		WRITE_ONCE(priv->rx_delim, -1);
+	} else {
+		ret = kstrtou8(buf, 0, &delim);
+		if (ret)
+			return ret;
+		WRITE_ONCE(priv->rx_delim, delim);
+	}
+
+	guard(serial8250_rpm)(up);
+	guard(uart_port_lock_irqsave)(&up->port);
+
+	/* A closed port picks it up from set_termios on open */
+	if (tty_port_initialized(&up->port.state->port))
+		omap8250_rx_delim_write(up, priv);
+
+	return count;
+}
+static DEVICE_ATTR_RW(rx_delimiter);
+
+static struct attribute *omap8250_attrs[] = {
+	&dev_attr_rx_trig_policy.attr,
+	&dev_attr_rx_trig_level.attr,
+	&dev_attr_rx_poll_irqs.attr,
+	&dev_attr_latency_target_us.attr,
+	&dev_attr_rx_delimiter.attr,
+	NULL
+};
+
+static ssize_t omap8250_rx_dma_store(struct device *dev, const char *buf,
+				     size_t count, bool nbufs)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	u32 size = priv->rx_dma_buf_size;
+	u32 bufs = priv->rx_dma_nbufs;
+	u32 val;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &val);
+	if (ret)
+		return ret;
+	if (!priv->omap8250_dma.fn)
+		return -EOPNOTSUPP;
+
+	if (nbufs)
+		bufs = val;
+	else
+		size = val;
+	ret = omap8250_rx_dma_check(priv, size, bufs);
+	if (ret)
+		return ret;
+
+	guard(uart_port_lock_irqsave)(&up->port);
+	if (up->dma)
+		return -EBUSY;
+
+	priv->rx_dma_buf_size = size;
+	priv->rx_dma_nbufs = bufs;
+
+	return count;
+}
+
+static ssize_t rx_dma_size_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", priv->rx_dma_buf_size);
+}
+
+static ssize_t rx_dma_size_store(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	return omap8250_rx_dma_store(dev, buf, count, false);
+}
+
+static ssize_t rx_dma_buffers_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", priv->rx_dma_nbufs);
+}
+
+static ssize_t rx_dma_buffers_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	return omap8250_rx_dma_store(dev, buf, count, true);
+}
+
+#define OMAP8250_RX_DMA_COUNTER(_name, _expr)				\
+static ssize_t rx_dma_##_name##_show(struct device *dev,		\
+				     struct device_attribute *attr,	\
+				     char *buf)				\
+{									\
+	struct omap8250_priv *priv = dev_get_drvdata(dev);		\
+									\
+	return sysfs_emit(buf, "%llu\n", (unsigned long long)(_expr));	\
+}									\
+static struct device_attribute dev_attr_rx_dma_##_name =		\
+	__ATTR(_name, 0444, rx_dma_##_name##_show, NULL)
+
+OMAP8250_RX_DMA_COUNTER(completions, priv->rx_dma_completions);
+OMAP8250_RX_DMA_COUNTER(flushes, priv->rx_dma_flushes);
+OMAP8250_RX_DMA_COUNTER(bytes, priv->rx_dma_bytes);
+OMAP8250_RX_DMA_COUNTER(bytes_per_completion,
+			div64_u64(priv->rx_dma_bytes,
+				  max(priv->rx_dma_completions +
+				      priv->rx_dma_flushes, 1ULL)));
+OMAP8250_RX_DMA_COUNTER(buf_overrun,
+			serial8250_get_port(priv->line)->port.icount.buf_overrun);
+
+static ssize_t rx_dma_raw_stamps_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", priv->rx_raw_stamped);
+}
+
+/* Stamped records instead of a plain byte stream, only while it is closed */
+static ssize_t rx_dma_raw_stamps_store(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+	bool on;
+	int ret;
+
+	ret = kstrtobool(buf, &on);
+	if (ret)
+		return ret;
+	if (!priv->rx_dma_raw)
+		return -EOPNOTSUPP;
+
+	guard(mutex)(&priv->rx_raw_lock);
+	if (test_bit(0, &priv->rx_raw_busy))
+		return -EBUSY;
+	priv->rx_raw_stamped = on;
+
+	return count;
+}
+
+static struct device_attribute dev_attr_rx_dma_size =
+	__ATTR(size, 0644, rx_dma_size_show, rx_dma_size_store);
+static struct device_attribute dev_attr_rx_dma_buffers =
+	__ATTR(buffers, 0644, rx_dma_buffers_show, rx_dma_buffers_store);
+static struct device_attribute dev_attr_rx_dma_raw_stamps =
+	__ATTR(raw_stamps, 0644, rx_dma_raw_stamps_show,
+	       rx_dma_raw_stamps_store);
+
+static struct attribute *omap8250_rx_dma_attrs[] = {
+	&dev_attr_rx_dma_size.attr,
+	&dev_attr_rx_dma_buffers.attr,
+	&dev_attr_rx_dma_completions.attr,
+	&dev_attr_rx_dma_flushes.attr,
+	&dev_attr_rx_dma_bytes.attr,
+	&dev_attr_rx_dma_bytes_per_completion.attr,
+	&dev_attr_rx_dma_buf_overrun.attr,
+	&dev_attr_rx_dma_raw_stamps.attr,
+	NULL
+};
+
+static ssize_t baud_tolerance_ppm_show(struct device *dev,
+				       struct device_attribute *attr, char *buf)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(priv->baud_tol_ppm));
+}
+
+/* Takes effect with the next termios change */
+static ssize_t baud_tolerance_ppm_store(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t count)
+{
+	struct omap8250_priv *priv = dev_get_drvdata(dev);
+	u32 tol;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &tol);
+	if (ret)
+		return ret;
+	if (tol > 1000000)
+		return -EINVAL;
+
+	WRITE_ONCE(priv->baud_tol_ppm, tol);
+
+	return count;
+}
+
+#define OMAP8250_BAUD_ATTR(_name, _fmt, _expr)				\
+static ssize_t baud_##_name##_show(struct device *dev,			\
+				   struct device_attribute *attr,	\
+				   char *buf)				\
+{									\
+	struct omap8250_priv *priv = dev_get_drvdata(dev);		\
+									\
+	return sysfs_emit(buf, _fmt "\n", _expr);			\
+}									\
+static struct device_attribute dev_attr_baud_##_name =			\
+	__ATTR(_name, 0444, baud_##_name##_show, NULL)
+
+OMAP8250_BAUD_ATTR(requested, "%u", priv->baud_req);
+OMAP8250_BAUD_ATTR(actual, "%u", priv->baud_actual);
+OMAP8250_BAUD_ATTR(error_ppm, "%d", priv->baud_ppm);
+OMAP8250_BAUD_ATTR(divisor, "%u", priv->quot);
+OMAP8250_BAUD_ATTR(oversampling, "%u",
+		   priv->mdr1 == UART_OMAP_MDR1_13X_MODE ? 13 : 16);
+
+static struct device_attribute dev_attr_baud_tolerance_ppm =
+	__ATTR(tolerance_ppm, 0644, baud_tolerance_ppm_show,
+	       baud_tolerance_ppm_store);
+
+static struct attribute *omap8250_baud_attrs[] = {
+	&dev_attr_baud_requested.attr,
+	&dev_attr_baud_actual.attr,
+	&dev_attr_baud_error_ppm.attr,
+	&dev_attr_baud_divisor.attr,
+	&dev_attr_baud_oversampling.attr,
+	&dev_attr_baud_tolerance_ppm.attr,
+	NULL
+};
+
+static const struct attribute_group omap8250_group = {
+	.attrs = omap8250_attrs,
+};
+
+static const struct attribute_group omap8250_rx_dma_group = {
+	.name = "rx_dma",
+	.attrs = omap8250_rx_dma_attrs,
+};
+
+static const struct attribute_group omap8250_baud_group = {
+	.name = "baud",
+	.attrs = omap8250_baud_attrs,
+};
+
+static const struct attribute_group *omap8250_groups[] = {
+	&omap8250_group,
+	&omap8250_rx_dma_group,
+	&omap8250_baud_group,
+	NULL
+};
+
+static int omap_8250_startup(struct uart_port *port)
+{
+	struct uart_8250_port *up = up_to_u8250p(port);
+	struct omap8250_priv *priv = port->private_data;
+	struct uart_8250_dma *dma = &priv->omap8250_dma;
+	int ret;
+
+	if (priv->wakeirq) {
+		ret = dev_pm_set_dedicated_wake_irq(port->dev, priv->wakeirq);
+		if (ret)
+			return ret;
+	}
+
+#ifdef CONFIG_PM
+	up->capabilities |= UART_CAP_RPM;
+#endif
+
+	guard(serial8250_rpm)(up);
+
+	priv->hw.valid = false;
 	serial_out(up, UART_FCR, UART_FCR_CLEAR_RCVR | UART_FCR_CLEAR_XMIT);
 
 	serial_out(up, UART_LCR, UART_LCR_WLEN8);
@@ -747,6 +2809,7 @@ static int omap_8250_startup(struct uart_port *port)
 	/* Disable DMA for console UART */
 	if (dma->fn && !uart_console(port)) {
 		up->dma = &priv->omap8250_dma;
+		omap8250_rx_dma_setup(priv);
 		ret = serial8250_request_dma(up);
 		if (ret) {
 			dev_warn_ratelimited(port->dev,
@@ -763,6 +2826,9 @@ static int omap_8250_startup(struct uart_port *port)
 		serial_out(up, UART_IER, up->ier);
 	}
 
+	omap8250_rx_trig_reset_window(priv);
+	priv->rx_poll_count = 0;
+
 	/* Enable module level wake up */
 	priv->wer = OMAP_UART_WER_MOD_WKUP;
 	if (priv->habit & OMAP_UART_WER_HAS_TX_WAKEUP)
@@ -789,6 +2855,15 @@ static void omap_8250_shutdown(struct uart_port *port)
 	flush_work(&priv->qos_work);
 	if (up->dma)
 		omap_8250_rx_dma_flush(up);
+	omap8250_rx_poll_stop(priv, port->dev);
+
+	/* A deferred RS-485 stop still owes RTS and the TX PM reference */
+	hrtimer_cancel(&priv->em485_temt_timer);
+	scoped_guard(uart_port_lock_irq, port) {
+		if (priv->em485_temt_pending && up->em485)
+			omap8250_em485_finish(up, false);
+		priv->em485_temt_pending = false;
+	}
 
 	serial_out(up, UART_OMAP_WER, 0);
 	if (priv->habit & UART_HAS_EFR2)
@@ -803,8 +2878,12 @@ static void omap_8250_shutdown(struct uart_port *port)
 	disable_irq_nosync(port->irq);
 	dev_pm_clear_wake_irq(port->dev);
 
-	serial8250_release_dma(up);
-	up->dma = NULL;
+	scoped_guard(mutex, &priv->rx_raw_lock) {
+		priv->rx_raw_active = false;
+		serial8250_release_dma(up);
+		up->dma = NULL;
+	}
+	wake_up_interruptible(&priv->rx_raw_wait);
 
 	/*
 	 * Disable break condition and FIFOs
@@ -812,17 +2891,23 @@ static void omap_8250_shutdown(struct uart_port *port)
 	if (up->lcr & UART_LCR_SBC)
 		serial_out(up, UART_LCR, up->lcr & ~UART_LCR_SBC);
 	serial_out(up, UART_FCR, UART_FCR_CLEAR_RCVR | UART_FCR_CLEAR_XMIT);
+	priv->hw.valid = false;
 }
 
 static void omap_8250_throttle(struct uart_port *port)
 {
 	struct omap8250_priv *priv = port->private_data;
+	struct uart_8250_port *up = up_to_u8250p(port);
 
-	guard(serial8250_rpm)(up_to_u8250p(port));
+	guard(serial8250_rpm)(up);
 	guard(uart_port_lock_irqsave)(port);
 
 	port->ops->stop_rx(port);
 	priv->throttled = true;
+
+	/* A cyclic channel would keep filling the ring, stop it until unthrottle */
+	if (up->dma && priv->rx_dma_cyclic)
+		omap_8250_rx_dma_flush(up);
 }
 
 static void omap_8250_unthrottle(struct uart_port *port)
@@ -837,6 +2922,9 @@ static void omap_8250_unthrottle(struct uart_port *port)
 	priv->throttled = false;
 	if (up->dma)
 		up->dma->rx_dma(up);
+	/* A pending poll still owns RX and unmasks it when the burst ends */
+	if (priv->rx_polling)
+		return;
 	up->ier |= UART_IER_RLSI | UART_IER_RDI;
 	serial_out(up, UART_IER, up->ier);
 }
@@ -875,6 +2963,8 @@ static int omap8250_rs485_config(struct uart_port *port,
 	 * hardware support, if the device tree specifies an mctrl_gpio
 	 * (indicates that RTS is unavailable due to a pinmux conflict)
 	 * or if the requested delays exceed the fixed hardware delays.
+	 * Stay the rs485_config callback either way, so that a later
+	 * configuration within the hardware limits gets MDR3 back.
 	 */
 	if (!(priv->habit & UART_HAS_NATIVE_RS485) ||
 	    mctrl_gpio_to_gpiod(up->gpios, UART_GPIO_RTS) ||
@@ -883,10 +2973,24 @@ static int omap8250_rs485_config(struct uart_port *port,
 		priv->mdr3 &= ~UART_OMAP_MDR3_DIR_EN;
 		serial_out(up, UART_OMAP_MDR3, priv->mdr3);
 
-		port->rs485_config = serial8250_em485_config;
+		/* No TEMT interrupt, let em485 time the shift register out instead */
+		up->capabilities |= UART_CAP_NOTEMT;
 		return serial8250_em485_config(port, termios, rs485);
 	}
 
+	/*
+	 * A deferred em485 stop would find up->em485 gone and leave RTS and
+	 * the TX PM reference behind, so settle it now. The port lock is held;
+	 * a timer already waiting for it sees nothing pending.
+	 */
+	hrtimer_try_to_cancel(&priv->em485_temt_timer);
+	if (priv->em485_temt_pending && up->em485)
+		omap8250_em485_finish(up, priv->em485_toggle_ier);
+	priv->em485_temt_pending = false;
+
+	serial8250_em485_destroy(up);
+	up->capabilities &= ~UART_CAP_NOTEMT;
+
 	rs485->delay_rts_after_send  = fixed_delay_rts_after_send;
 	rs485->delay_rts_before_send = fixed_delay_rts_before_send;
 
@@ -911,9 +3015,27 @@ static int omap8250_rs485_config(struct uart_port *port,
 
 #ifdef CONFIG_SERIAL_8250_DMA
 static int omap_8250_rx_dma(struct uart_8250_port *p);
+static int __omap_8250_rx_dma_submit(struct uart_8250_port *p);
+
+static void omap_8250_rx_dma_insert(struct uart_8250_port *p, u32 off, u32 count)
+{
+	struct omap8250_priv *priv = p->port.private_data;
+	struct tty_port *tty_port = &p->port.state->port;
+	int ret;
+
+	ret = tty_insert_flip_string(tty_port, p->dma->rx_buf + off, count);
+
+	p->port.icount.rx += ret;
+	p->port.icount.buf_overrun += count - ret;
+	priv->rx_dma_bytes += ret;
+}
 
-/* Must be called while priv->rx_dma_lock is held */
-static void __dma_rx_do_complete(struct uart_8250_port *p)
+/*
+ * Must be called while priv->rx_dma_lock is held. With @rearm and more than
+ * one buffer the next slot is armed before the finished one is copied out,
+ * so the channel is only idle for the time it takes to submit.
+ */
+static void __dma_rx_do_complete(struct uart_8250_port *p, bool rearm)
 {
 	struct uart_8250_dma    *dma = p->dma;
 	struct tty_port         *tty_port = &p->port.state->port;
@@ -922,14 +3044,15 @@ static void __dma_rx_do_complete(struct uart_8250_port *p)
 	dma_cookie_t		cookie;
 	struct dma_tx_state     state;
 	int                     count;
-	int			ret;
 	u32			reg;
+	u32			off;
 
 	if (!dma->rx_running)
 		goto out;
 
 	cookie = dma->rx_cookie;
 	dma->rx_running = 0;
+	off = priv->rx_dma_slot * priv->rx_dma_buf_size;
 
 	/* Re-enable RX FIFO interrupt now that transfer is complete */
 	if (priv->habit & UART_HAS_RHR_IT_DIS) {
@@ -940,62 +3063,223 @@ static void __dma_rx_do_complete(struct uart_8250_port *p)
 
 	dmaengine_tx_status(rxchan, cookie, &state);
 
-	count = dma->rx_size - state.residue + state.in_flight_bytes;
-	if (count < dma->rx_size) {
+	count = priv->rx_dma_buf_size - state.residue + state.in_flight_bytes;
+	if (count < priv->rx_dma_buf_size) {
+		priv->rx_dma_flushes++;
 		dmaengine_terminate_async(rxchan);
 
-		/*
-		 * Poll for teardown to complete which guarantees in
-		 * flight data is drained.
-		 */
-		if (state.in_flight_bytes) {
-			int poll_count = 25;
+		/*
+		 * Poll for teardown to complete which guarantees in
+		 * flight data is drained.
+		 */
+		if (state.in_flight_bytes) {
+			int poll_count = 25;
+
+			while (dmaengine_tx_status(rxchan, cookie, NULL) &&
+			       poll_count--)
+				cpu_relax();
+
+			if (poll_count == -1)
+				dev_err(p->port.dev, "teardown incomplete\n");
+		}
+	} else {
+		priv->rx_dma_completions++;
+	}
+
+	if (priv->rx_dma_nbufs > 1) {
+		priv->rx_dma_slot = (priv->rx_dma_slot + 1) % priv->rx_dma_nbufs;
+		if (rearm && count == priv->rx_dma_buf_size)
+			__omap_8250_rx_dma_submit(p);
+	}
+
+	if (!count)
+		goto out;
+	omap_8250_rx_dma_insert(p, off, count);
+	omap8250_stats_rx(priv, count, true);
+out:
+
+	tty_flip_buffer_push(tty_port);
+}
+
+static void __dma_rx_complete(void *param)
+{
+	struct uart_8250_port *p = param;
+	struct omap8250_priv *priv = p->port.private_data;
+	struct uart_8250_dma *dma = p->dma;
+	struct dma_tx_state     state;
+
+	/* Synchronize UART_IER access against the console. */
+	guard(uart_port_lock_irqsave)(&p->port);
+
+	/*
+	 * If the tx status is not DMA_COMPLETE, then this is a delayed
+	 * completion callback. A previous RX timeout flush would have
+	 * already pushed the data, so exit.
+	 */
+	if (dmaengine_tx_status(dma->rxchan, dma->rx_cookie, &state) != DMA_COMPLETE)
+		return;
+
+	__dma_rx_do_complete(p, !priv->throttled &&
+			     !(priv->habit & UART_HAS_EFR2));
+	if (priv->throttled)
+		return;
+
+	p->ier |= UART_IER_RLSI | UART_IER_RDI;
+	serial_out(p, UART_IER, p->ier);
+	if (!(priv->habit & UART_HAS_EFR2))
+		omap_8250_rx_dma(p);
+}
+
+static void omap8250_raw_drop(struct omap8250_priv *priv,
+			      struct uart_port *port)
+{
+	port->icount.buf_overrun += priv->rx_raw_avail;
+	priv->rx_raw_avail = 0;
+	priv->rx_stamp_tail = priv->rx_stamp_head;
+	priv->rx_raw_gen++;
+}
+
+/*
+ * Queue a record for @len new bytes. With the queue full they are added to
+ * the newest record, which keeps its older stamp: the bytes are not lost,
+ * only the timing gets coarser.
+ */
+static void omap8250_raw_stamp(struct omap8250_priv *priv, u32 len, u64 ns,
+			       u32 src)
+{
+	struct omap8250_rx_stamp *rec;
+
+	priv->stats.rx_stamp_src[src]++;
+	if (src == OMAP8250_STAMP_IRQ)
+		priv->stats.rx_stamp_lag_ns_max =
+			max(priv->stats.rx_stamp_lag_ns_max, ktime_get_ns() - ns);
+
+	if (priv->rx_stamp_head - priv->rx_stamp_tail == OMAP8250_RX_STAMPS) {
+		rec = &priv->rx_stamps[(priv->rx_stamp_head - 1) % OMAP8250_RX_STAMPS];
+		rec->len += len;
+		priv->stats.rx_stamp_merges++;
+		return;
+	}
+
+	rec = &priv->rx_stamps[priv->rx_stamp_head++ % OMAP8250_RX_STAMPS];
+	rec->ns = ns;
+	rec->len = len;
+	rec->src = src;
+}
+
+/*
+ * Cyclic mode: the channel never stops, so instead of tearing it down we
+ * read the write position from the residue and hand over everything
+ * between our tail and that position, in two pieces if the ring wrapped.
+ * While the raw device is open the data stays in the ring for its reader
+ * and only the head and fill level are updated here, plus a timestamp
+ * record of @src taken at @ns in stamped mode.
+ *
+ * Must be called while priv->rx_dma_lock is held.
+ */
+static void __dma_rx_cyclic_poll(struct uart_8250_port *p, u64 ns, u32 src)
+{
+	struct uart_8250_dma	*dma = p->dma;
+	struct omap8250_priv	*priv = p->port.private_data;
+	struct dma_tx_state	state;
+	u32			head;
+
+	if (!dma->rx_running)
+		return;
+
+	dmaengine_tx_status(dma->rxchan, dma->rx_cookie, &state);
+	if (state.residue > dma->rx_size)
+		return;
 
-			while (dmaengine_tx_status(rxchan, cookie, NULL) &&
-			       poll_count--)
-				cpu_relax();
+	head = (dma->rx_size - state.residue) % dma->rx_size;
+	if (head == priv->rx_dma_head)
+		return;
 
-			if (poll_count == -1)
-				dev_err(p->port.dev, "teardown incomplete\n");
+	if (priv->rx_raw_active) {
+		u32 delta = (head - priv->rx_dma_head + dma->rx_size) % dma->rx_size;
+
+		priv->rx_dma_head = head;
+		priv->rx_raw_avail += delta;
+		priv->rx_dma_bytes += delta;
+		omap8250_stats_rx(priv, delta, true);
+		p->port.icount.rx += delta;
+		if (priv->rx_raw_stamped)
+			omap8250_raw_stamp(priv, delta, ns, src);
+
+		/* Within a period of the tail the DMA may already be overwriting it */
+		if (priv->rx_raw_avail > dma->rx_size - priv->rx_dma_period) {
+			omap8250_raw_drop(priv, &p->port);
+			priv->rx_dma_tail = head;
 		}
+		wake_up_interruptible(&priv->rx_raw_wait);
+		return;
 	}
-	if (!count)
-		goto out;
-	ret = tty_insert_flip_string(tty_port, dma->rx_buf, count);
 
-	p->port.icount.rx += ret;
-	p->port.icount.buf_overrun += count - ret;
-out:
+	/* A wrapped ring is still one RX event */
+	omap8250_stats_rx(priv, (head - priv->rx_dma_tail + dma->rx_size) %
+			  dma->rx_size, true);
+	if (head < priv->rx_dma_tail) {
+		omap_8250_rx_dma_insert(p, priv->rx_dma_tail,
+					dma->rx_size - priv->rx_dma_tail);
+		priv->rx_dma_tail = 0;
+	}
+	if (head > priv->rx_dma_tail)
+		omap_8250_rx_dma_insert(p, priv->rx_dma_tail,
+					head - priv->rx_dma_tail);
+	priv->rx_dma_tail = head;
+	priv->rx_dma_head = head;
 
-	tty_flip_buffer_push(tty_port);
+	tty_flip_buffer_push(&p->port.state->port);
 }
 
-static void __dma_rx_complete(void *param)
+static void omap_8250_rx_dma_poll(struct uart_8250_port *p, u64 ns, u32 src)
+{
+	struct omap8250_priv *priv = p->port.private_data;
+
+	guard(spinlock_irqsave)(&priv->rx_dma_lock);
+	__dma_rx_cyclic_poll(p, ns, src);
+}
+
+/* Period elapsed callback of the cyclic descriptor */
+static void __dma_rx_cyclic_complete(void *param)
 {
 	struct uart_8250_port *p = param;
 	struct omap8250_priv *priv = p->port.private_data;
-	struct uart_8250_dma *dma = p->dma;
-	struct dma_tx_state     state;
 
-	/* Synchronize UART_IER access against the console. */
 	guard(uart_port_lock_irqsave)(&p->port);
+	priv->rx_dma_completions++;
+	omap_8250_rx_dma_poll(p, ktime_get_ns(), OMAP8250_STAMP_DMA);
+}
 
-	/*
-	 * If the tx status is not DMA_COMPLETE, then this is a delayed
-	 * completion callback. A previous RX timeout flush would have
-	 * already pushed the data, so exit.
-	 */
-	if (dmaengine_tx_status(dma->rxchan, dma->rx_cookie, &state) != DMA_COMPLETE)
-		return;
+/*
+ * Cyclic mode: stop the channel, keeping everything it wrote. A burst
+ * still in flight lands during the pause and is collected before the
+ * terminate, so PIO reading the FIFO afterwards cannot overtake it. The
+ * terminate also drops a DMA request EDMA latched meanwhile, which on a
+ * paused channel would fire on resume and read a burst from the RHR
+ * whatever the FIFO holds; omap_8250_rx_dma() re-preps the ring.
+ *
+ * Must be called while priv->rx_dma_lock is held.
+ */
+static void __dma_rx_cyclic_stop(struct uart_8250_port *p, u64 ns, u32 src)
+{
+	struct uart_8250_dma *dma = p->dma;
 
-	__dma_rx_do_complete(p);
-	if (priv->throttled)
-		return;
+	if (dmaengine_pause(dma->rxchan))
+		dev_warn_once(p->port.dev, "RX DMA pause failed, PIO may reorder\n");
+	__dma_rx_cyclic_poll(p, ns, src);
+	dmaengine_terminate_async(dma->rxchan);
+	dma->rx_running = 0;
+}
 
-	p->ier |= UART_IER_RLSI | UART_IER_RDI;
-	serial_out(p, UART_IER, p->ier);
-	if (!(priv->habit & UART_HAS_EFR2))
-		omap_8250_rx_dma(p);
+/* The FIFO tail below a burst is left to PIO, with the channel stopped */
+static void omap_8250_rx_dma_stop(struct uart_8250_port *p, u64 ns)
+{
+	struct omap8250_priv *priv = p->port.private_data;
+
+	guard(spinlock_irqsave)(&priv->rx_dma_lock);
+	if (p->dma->rx_running)
+		__dma_rx_cyclic_stop(p, ns, OMAP8250_STAMP_IRQ);
 }
 
 static void omap_8250_rx_dma_flush(struct uart_8250_port *p)
@@ -1013,24 +3297,80 @@ static void omap_8250_rx_dma_flush(struct uart_8250_port *p)
 		return;
 	}
 
+	/* Only reached on shutdown, throttle and runtime suspend */
+	if (priv->rx_dma_cyclic) {
+		__dma_rx_cyclic_stop(p, ktime_get_ns(), OMAP8250_STAMP_POLL);
+		spin_unlock_irqrestore(&priv->rx_dma_lock, flags);
+		return;
+	}
+
 	ret = dmaengine_tx_status(dma->rxchan, dma->rx_cookie, &state);
 	if (ret == DMA_IN_PROGRESS) {
 		ret = dmaengine_pause(dma->rxchan);
 		if (WARN_ON_ONCE(ret))
 			priv->rx_dma_broken = true;
 	}
-	__dma_rx_do_complete(p);
+	__dma_rx_do_complete(p, false);
 	spin_unlock_irqrestore(&priv->rx_dma_lock, flags);
 }
 
+/* Arms the current buffer slot. Must be called while priv->rx_dma_lock is held */
+static int __omap_8250_rx_dma_submit(struct uart_8250_port *p)
+{
+	struct omap8250_priv		*priv = p->port.private_data;
+	struct uart_8250_dma            *dma = p->dma;
+	struct dma_async_tx_descriptor  *desc;
+	u32				reg;
+
+	if (priv->rx_dma_cyclic)
+		desc = dmaengine_prep_dma_cyclic(dma->rxchan, dma->rx_addr,
+						 dma->rx_size, priv->rx_dma_period,
+						 DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
+	else
+		desc = dmaengine_prep_slave_single(dma->rxchan,
+						   dma->rx_addr + priv->rx_dma_slot *
+						   priv->rx_dma_buf_size,
+						   priv->rx_dma_buf_size, DMA_DEV_TO_MEM,
+						   DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!desc)
+		return -EBUSY;
+
+	dma->rx_running = 1;
+	if (priv->rx_dma_cyclic) {
+		/* A restarted ring begins at offset 0, unread raw data is gone */
+		if (priv->rx_raw_avail)
+			omap8250_raw_drop(priv, &p->port);
+		priv->rx_dma_tail = 0;
+		priv->rx_dma_head = 0;
+		desc->callback = __dma_rx_cyclic_complete;
+	} else {
+		desc->callback = __dma_rx_complete;
+	}
+	desc->callback_param = p;
+
+	dma->rx_cookie = dmaengine_submit(desc);
+
+	/*
+	 * Disable RX FIFO interrupt while RX DMA is enabled, else
+	 * spurious interrupt may be raised when data is in the RX FIFO
+	 * but is yet to be drained by DMA.
+	 */
+	if (priv->habit & UART_HAS_RHR_IT_DIS) {
+		reg = serial_in(p, UART_OMAP_IER2);
+		reg |= UART_OMAP_IER2_RHR_IT_DIS;
+		serial_out(p, UART_OMAP_IER2, reg);
+	}
+
+	dma_async_issue_pending(dma->rxchan);
+	return 0;
+}
+
 static int omap_8250_rx_dma(struct uart_8250_port *p)
 {
 	struct omap8250_priv		*priv = p->port.private_data;
 	struct uart_8250_dma            *dma = p->dma;
 	int				err = 0;
-	struct dma_async_tx_descriptor  *desc;
 	unsigned long			flags;
-	u32				reg;
 
 	/* Port locked to synchronize UART_IER access against the console. */
 	lockdep_assert_held_once(&p->port.lock);
@@ -1055,32 +3395,7 @@ static int omap_8250_rx_dma(struct uart_8250_port *p)
 		goto out;
 	}
 
-	desc = dmaengine_prep_slave_single(dma->rxchan, dma->rx_addr,
-					   dma->rx_size, DMA_DEV_TO_MEM,
-					   DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
-	if (!desc) {
-		err = -EBUSY;
-		goto out;
-	}
-
-	dma->rx_running = 1;
-	desc->callback = __dma_rx_complete;
-	desc->callback_param = p;
-
-	dma->rx_cookie = dmaengine_submit(desc);
-
-	/*
-	 * Disable RX FIFO interrupt while RX DMA is enabled, else
-	 * spurious interrupt may be raised when data is in the RX FIFO
-	 * but is yet to be drained by DMA.
-	 */
-	if (priv->habit & UART_HAS_RHR_IT_DIS) {
-		reg = serial_in(p, UART_OMAP_IER2);
-		reg |= UART_OMAP_IER2_RHR_IT_DIS;
-		serial_out(p, UART_OMAP_IER2, reg);
-	}
-
-	dma_async_issue_pending(dma->rxchan);
+	err = __omap_8250_rx_dma_submit(p);
 out:
 	spin_unlock_irqrestore(&priv->rx_dma_lock, flags);
 	return err;
@@ -1104,6 +3419,7 @@ static void omap_8250_dma_tx_complete(void *param)
 	dma->tx_running = 0;
 
 	uart_xmit_advance(&p->port, dma->tx_size);
+	priv->stats.tx_dma_bytes += dma->tx_size;
 
 	if (priv->delayed_restore) {
 		priv->delayed_restore = 0;
@@ -1233,10 +3549,35 @@ out_skip:
 
 static bool handle_rx_dma(struct uart_8250_port *up, unsigned int iir)
 {
+	struct omap8250_priv *priv = up->port.private_data;
+
+	if (priv->rx_dma_cyclic && up->dma->rx_running) {
+		/*
+		 * RDI belongs to the DMA engine. A timeout or line status
+		 * interrupt means the FIFO holds less than a burst, which the
+		 * channel will never pick up, so let PIO drain that tail with
+		 * the channel stopped and restart the ring afterwards. The raw
+		 * reader owns every byte, none may go to the tty; it runs with
+		 * 1 byte bursts and never leaves a tail.
+		 */
+		switch (iir & 0x3f) {
+		case UART_IIR_RLSI:
+		case UART_IIR_RX_TIMEOUT:
+		case OMAP_UART_IIR_XOFF:
+			if (priv->rx_raw_active)
+				break;
+			omap_8250_rx_dma_stop(up, priv->irq_start_ns);
+			return true;
+		}
+		omap_8250_rx_dma_poll(up, priv->irq_start_ns, OMAP8250_STAMP_IRQ);
+		return false;
+	}
+
 	switch (iir & 0x3f) {
 	case UART_IIR_RLSI:
 	case UART_IIR_RX_TIMEOUT:
 	case UART_IIR_RDI:
+	case OMAP_UART_IIR_XOFF:
 		omap_8250_rx_dma_flush(up);
 		return true;
 	}
@@ -1245,12 +3586,33 @@ static bool handle_rx_dma(struct uart_8250_port *up, unsigned int iir)
 
 static u16 omap_8250_handle_rx_dma(struct uart_8250_port *up, u8 iir, u16 status)
 {
-	if ((status & (UART_LSR_DR | UART_LSR_BI)) &&
-	    (iir & UART_IIR_RDI)) {
-		if (handle_rx_dma(up, iir)) {
+	struct omap8250_priv *priv = up->port.private_data;
+	bool delim = (iir & 0x3f) == OMAP_UART_IIR_XOFF;
+
+	/*
+	 * A delimiter that arrives while throttled waits for the unthrottle.
+	 * The raw reader masks RDI too but wants it, to stamp the frame.
+	 */
+	if (delim && priv->throttled)
+		return status;
+
+	/*
+	 * By the time the delimiter interrupt is taken the DMA may already
+	 * have emptied the FIFO, so it goes to the ring whatever DR says.
+	 */
+	if (!delim && !((status & (UART_LSR_DR | UART_LSR_BI)) &&
+			(iir & UART_IIR_RDI)))
+		return status;
+
+	if (handle_rx_dma(up, iir)) {
+		if (status & (UART_LSR_DR | UART_LSR_BI)) {
+			__u32 rx_before = up->port.icount.rx;
+
 			status = serial8250_rx_chars(up, status);
-			omap_8250_rx_dma(up);
+			omap8250_stats_rx(up->port.private_data,
+					  up->port.icount.rx - rx_before, false);
 		}
+		omap_8250_rx_dma(up);
 	}
 
 	return status;
@@ -1301,6 +3663,8 @@ static int omap_8250_dma_handle_irq(struct uart_port *port)
 	if (iir & UART_IIR_NO_INT) {
 		return IRQ_HANDLED;
 	}
+	if ((iir & 0x3f) == OMAP_UART_IIR_XOFF)
+		priv->stats.rx_delim_irqs++;
 
 	uart_port_lock(port);
 
@@ -1318,14 +3682,14 @@ static int omap_8250_dma_handle_irq(struct uart_port *port)
 		if (uart_tx_stopped(port) ||
 		    kfifo_is_empty(&port->state->port.xmit_fifo)) {
 			up->dma->tx_err = 0;
-			serial8250_tx_chars(up);
+			omap_8250_tx_chars(up);
 		} else  {
 			/*
 			 * try again due to an earlier failure which
 			 * might have been resolved by now.
 			 */
 			if (omap_8250_tx_dma(up))
-				serial8250_tx_chars(up);
+				omap_8250_tx_chars(up);
 		}
 	}
 
@@ -1339,12 +3703,273 @@ static bool the_no_dma_filter_fn(struct dma_chan *chan, void *param)
 	return false;
 }
 
+/*
+ * Raw RX device ("ttySn-raw"): read() copies straight out of the cyclic
+ * DMA ring into the user buffer, skipping the flip buffer and the line
+ * discipline. The tty has to be open (it owns baud rate and the DMA
+ * channel); while the raw device is open the tty sees no RX data.
+ */
+static struct omap8250_priv *raw_to_priv(struct file *file)
+{
+	return container_of(file->private_data, struct omap8250_priv,
+			    rx_raw_mdev);
+}
+
+/* Must be called with priv->rx_raw_lock held */
+static int omap8250_raw_start(struct omap8250_priv *priv,
+			      struct uart_8250_port *up)
+{
+	if (!up->dma || !up->dma->rx_running)
+		return -ENODEV;
+
+	guard(serial8250_rpm)(up);
+	guard(uart_port_lock_irqsave)(&up->port);
+
+	/* Whatever is already in the ring still belongs to the tty */
+	scoped_guard(spinlock, &priv->rx_dma_lock) {
+		__dma_rx_cyclic_poll(up, ktime_get_ns(), OMAP8250_STAMP_POLL);
+		priv->rx_raw_avail = 0;
+		priv->rx_stamp_tail = priv->rx_stamp_head;
+		priv->rx_raw_active = true;
+	}
+
+	/* The DMA engine takes every byte, don't interrupt for them */
+	up->ier &= ~(UART_IER_RLSI | UART_IER_RDI);
+	serial_out(up, UART_IER, up->ier);
+	return 0;
+}
+
+/* Must be called with priv->rx_raw_lock held */
+static void omap8250_raw_stop(struct omap8250_priv *priv,
+			      struct uart_8250_port *up)
+{
+	/* Shutdown already took the ring away */
+	if (!priv->rx_raw_active)
+		return;
+
+	guard(serial8250_rpm)(up);
+	guard(uart_port_lock_irqsave)(&up->port);
+
+	scoped_guard(spinlock, &priv->rx_dma_lock)
+		priv->rx_raw_active = false;
+
+	if (!priv->throttled) {
+		up->ier |= UART_IER_RLSI | UART_IER_RDI;
+		serial_out(up, UART_IER, up->ier);
+	}
+}
+
+static int omap8250_raw_open(struct inode *inode, struct file *file)
+{
+	struct omap8250_priv *priv = raw_to_priv(file);
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	int ret;
+
+	if (test_and_set_bit(0, &priv->rx_raw_busy))
+		return -EBUSY;
+
+	scoped_guard(mutex, &priv->rx_raw_lock)
+		ret = omap8250_raw_start(priv, up);
+	if (ret) {
+		clear_bit(0, &priv->rx_raw_busy);
+		return ret;
+	}
+
+	return stream_open(inode, file);
+}
+
+static int omap8250_raw_release(struct inode *inode, struct file *file)
+{
+	struct omap8250_priv *priv = raw_to_priv(file);
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+
+	scoped_guard(mutex, &priv->rx_raw_lock)
+		omap8250_raw_stop(priv, up);
+
+	clear_bit(0, &priv->rx_raw_busy);
+	return 0;
+}
+
+/*
+ * Both readers return 0 when the ring is empty. Must be called with
+ * priv->rx_raw_lock held, which keeps shutdown from freeing the ring.
+ */
+static ssize_t omap8250_raw_read_bytes(struct omap8250_priv *priv,
+				       struct uart_8250_port *up,
+				       char __user *buf, size_t count)
+{
+	u32 tail, gen;
+	size_t len;
+
+	scoped_guard(spinlock_irqsave, &priv->rx_dma_lock) {
+		__dma_rx_cyclic_poll(up, ktime_get_ns(), OMAP8250_STAMP_POLL);
+		tail = priv->rx_dma_tail;
+		gen = priv->rx_raw_gen;
+		len = min_t(size_t, count, priv->rx_raw_avail);
+		len = min_t(size_t, len, up->dma->rx_size - tail);
+	}
+
+	if (!len)
+		return 0;
+	if (copy_to_user(buf, up->dma->rx_buf + tail, len))
+		return -EFAULT;
+
+	guard(spinlock_irqsave)(&priv->rx_dma_lock);
+	/* Overrun while copying, the copy may be torn */
+	if (gen != priv->rx_raw_gen)
+		return -EIO;
+	priv->rx_dma_tail = (tail + len) % up->dma->rx_size;
+	priv->rx_raw_avail -= len;
+	return len;
+}
+
+/*
+ * One record per read: the header and as much of its data as fits in
+ * @count and in the ring before it wraps. The rest stays queued as a
+ * record with the same stamp.
+ */
+static ssize_t omap8250_raw_read_stamped(struct omap8250_priv *priv,
+					 struct uart_8250_port *up,
+					 char __user *buf, size_t count)
+{
+	struct omap8250_rx_stamp hdr;
+	u32 tail, gen, idx;
+	size_t len;
+
+	if (count <= sizeof(hdr))
+		return -EINVAL;
+
+	scoped_guard(spinlock_irqsave, &priv->rx_dma_lock) {
+		__dma_rx_cyclic_poll(up, ktime_get_ns(), OMAP8250_STAMP_POLL);
+		if (priv->rx_stamp_head == priv->rx_stamp_tail)
+			return 0;
+
+		idx = priv->rx_stamp_tail % OMAP8250_RX_STAMPS;
+		hdr = priv->rx_stamps[idx];
+		tail = priv->rx_dma_tail;
+		gen = priv->rx_raw_gen;
+	}
+
+	len = min_t(size_t, hdr.len, count - sizeof(hdr));
+	len = min_t(size_t, len, up->dma->rx_size - tail);
+	hdr.len = len;
+
+	if (copy_to_user(buf, &hdr, sizeof(hdr)) ||
+	    copy_to_user(buf + sizeof(hdr), up->dma->rx_buf + tail, len))
+		return -EFAULT;
+
+	guard(spinlock_irqsave)(&priv->rx_dma_lock);
+	if (gen != priv->rx_raw_gen)
+		return -EIO;
+	priv->rx_dma_tail = (tail + len) % up->dma->rx_size;
+	priv->rx_raw_avail -= len;
+	priv->rx_stamps[idx].len -= len;
+	if (!priv->rx_stamps[idx].len)
+		priv->rx_stamp_tail++;
+	return sizeof(hdr) + len;
+}
+
+static ssize_t omap8250_raw_read(struct file *file, char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct omap8250_priv *priv = raw_to_priv(file);
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	ssize_t len;
+	int ret;
+
+	if (!count)
+		return 0;
+
+	for (;;) {
+		scoped_guard(mutex, &priv->rx_raw_lock) {
+			if (!priv->rx_raw_active)
+				return -EIO;
+
+			if (priv->rx_raw_stamped)
+				len = omap8250_raw_read_stamped(priv, up, buf, count);
+			else
+				len = omap8250_raw_read_bytes(priv, up, buf, count);
+			if (len)
+				return len;
+		}
+
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		/* No RX interrupts in raw mode, re-read the residue every tick */
+		ret = wait_event_interruptible_timeout(priv->rx_raw_wait,
+						       READ_ONCE(priv->rx_raw_avail) ||
+						       !READ_ONCE(priv->rx_raw_active),
+						       1);
+		if (ret < 0)
+			return ret;
+	}
+}
+
+static __poll_t omap8250_raw_poll(struct file *file, poll_table *wait)
+{
+	struct omap8250_priv *priv = raw_to_priv(file);
+	struct uart_8250_port *up = serial8250_get_port(priv->line);
+	__poll_t mask = 0;
+
+	poll_wait(file, &priv->rx_raw_wait, wait);
+
+	guard(mutex)(&priv->rx_raw_lock);
+	if (!priv->rx_raw_active)
+		return EPOLLERR;
+
+	guard(spinlock_irqsave)(&priv->rx_dma_lock);
+	__dma_rx_cyclic_poll(up, ktime_get_ns(), OMAP8250_STAMP_POLL);
+	if (priv->rx_raw_avail)
+		mask |= EPOLLIN | EPOLLRDNORM;
+
+	return mask;
+}
+
+static const struct file_operations omap8250_raw_fops = {
+	.owner		= THIS_MODULE,
+	.open		= omap8250_raw_open,
+	.release	= omap8250_raw_release,
+	.read		= omap8250_raw_read,
+	.poll		= omap8250_raw_poll,
+};
+
+static void omap8250_raw_register(struct platform_device *pdev,
+				  struct omap8250_priv *priv)
+{
+	int ret;
+
+	priv->rx_raw_mdev.minor = MISC_DYNAMIC_MINOR;
+	priv->rx_raw_mdev.fops = &omap8250_raw_fops;
+	priv->rx_raw_mdev.parent = &pdev->dev;
+	priv->rx_raw_mdev.name = devm_kasprintf(&pdev->dev, GFP_KERNEL,
+						"ttyS%d-raw", priv->line);
+	if (!priv->rx_raw_mdev.name)
+		return;
+
+	ret = misc_register(&priv->rx_raw_mdev);
+	if (ret) {
+		dev_warn(&pdev->dev, "raw RX device unavailable: %d\n", ret);
+		priv->rx_raw_mdev.name = NULL;
+	}
+}
+
+static void omap8250_raw_unregister(struct omap8250_priv *priv)
+{
+	if (priv->rx_raw_mdev.name)
+		misc_deregister(&priv->rx_raw_mdev);
+}
+
 #else
 
 static inline int omap_8250_rx_dma(struct uart_8250_port *p)
 {
 	return -EINVAL;
 }
+
+static inline void omap8250_raw_register(struct platform_device *pdev,
+					 struct omap8250_priv *priv) { }
+static inline void omap8250_raw_unregister(struct omap8250_priv *priv) { }
 #endif
 
 static int omap8250_no_handle_irq(struct uart_port *port)
@@ -1414,6 +4039,7 @@ static int omap8250_probe(struct platform_device *pdev)
 	struct uart_8250_port up;
 	struct resource *regs;
 	void __iomem *membase;
+	u32 delim;
 	int ret;
 
 	regs = platform_get_resource(pdev, IORESOURCE_MEM, 0);
@@ -1468,8 +4094,8 @@ static int omap8250_probe(struct platform_device *pdev)
 	up.port.rs485_config = omap8250_rs485_config;
 	/* same rs485_supported for software emulation and native RS485 */
 	up.port.rs485_supported = serial8250_em485_supported;
-	up.rs485_start_tx = serial8250_em485_start_tx;
-	up.rs485_stop_tx = serial8250_em485_stop_tx;
+	up.rs485_start_tx = omap8250_em485_start_tx;
+	up.rs485_stop_tx = omap8250_em485_stop_tx;
 	up.port.has_sysrq = IS_ENABLED(CONFIG_SERIAL_8250_CONSOLE);
 
 	ret = uart_read_port_properties(&up.port);
@@ -1495,6 +4121,11 @@ static int omap8250_probe(struct platform_device *pdev)
 				 &up.overrun_backoff_time_ms) != 0)
 		up.overrun_backoff_time_ms = 0;
 
+	priv->rx_delim = -1;
+	if (!of_property_read_u32(np, "ti,rx-frame-delimiter", &delim) &&
+	    delim <= 0xff)
+		priv->rx_delim = delim;
+
 	pdata = of_device_get_match_data(&pdev->dev);
 	if (pdata)
 		priv->habit |= pdata->habit;
@@ -1508,12 +4139,25 @@ static int omap8250_probe(struct platform_device *pdev)
 
 	priv->membase = membase;
 	priv->line = -ENODEV;
+	priv->baud_tol_ppm = OMAP8250_BAUD_TOL_PPM;
 	priv->latency = PM_QOS_CPU_LATENCY_DEFAULT_VALUE;
 	priv->calc_latency = PM_QOS_CPU_LATENCY_DEFAULT_VALUE;
+	priv->resume_latency = PM_QOS_RESUME_LATENCY_NO_CONSTRAINT;
+	ret = dev_pm_qos_add_request(&pdev->dev, &priv->resume_qos,
+				     DEV_PM_QOS_RESUME_LATENCY,
+				     priv->resume_latency);
+	if (ret < 0)
+		return ret;
 	cpu_latency_qos_add_request(&priv->pm_qos_request, priv->latency);
 	INIT_WORK(&priv->qos_work, omap8250_uart_qos_work);
+	hrtimer_setup(&priv->rx_poll_timer, omap8250_rx_poll, CLOCK_MONOTONIC,
+		      HRTIMER_MODE_REL);
+	hrtimer_setup(&priv->em485_temt_timer, omap8250_em485_temt,
+		      CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 
 	spin_lock_init(&priv->rx_dma_lock);
+	mutex_init(&priv->rx_raw_lock);
+	init_waitqueue_head(&priv->rx_raw_wait);
 
 	platform_set_drvdata(pdev, priv);
 
@@ -1553,6 +4197,7 @@ static int omap8250_probe(struct platform_device *pdev)
 	if (ret == 2) {
 		struct omap8250_dma_params *dma_params = NULL;
 		struct uart_8250_dma *dma = &priv->omap8250_dma;
+		u32 rx_size, rx_bufs;
 
 		dma->fn = the_no_dma_filter_fn;
 		dma->tx_dma = omap_8250_tx_dma;
@@ -1571,8 +4216,47 @@ static int omap8250_probe(struct platform_device *pdev)
 			dma->rxconf.src_maxburst = RX_TRIGGER;
 			dma->txconf.dst_maxburst = TX_TRIGGER;
 		}
+
+		/*
+		 * The AM654 EFR2 timeout handling relies on one-shot transfers,
+		 * everything else can run the RX channel as a never-ending ring.
+		 */
+		if (!(priv->habit & UART_HAS_EFR2) &&
+		    of_property_read_bool(np, "ti,rx-dma-raw")) {
+			/*
+			 * A raw reader gets no PIO fallback, so the DMA has to
+			 * move every byte instead of leaving a sub-burst tail
+			 * in the FIFO.
+			 */
+			priv->rx_dma_raw = true;
+			priv->rx_trigger = 1;
+			dma->rxconf.src_maxburst = 1;
+		}
+
+		if (!(priv->habit & UART_HAS_EFR2) &&
+		    (priv->rx_dma_raw ||
+		     of_property_read_bool(np, "ti,rx-dma-cyclic"))) {
+			priv->rx_dma_cyclic = true;
+			dma->rx_size = max_t(u32, SZ_4K, dma->rxconf.src_maxburst *
+					     RX_DMA_CYCLIC_BURSTS *
+					     RX_DMA_CYCLIC_PERIODS);
+		}
+
+		rx_size = dma->rx_size;
+		rx_bufs = 1;
+		of_property_read_u32(np, "ti,rx-dma-size", &rx_size);
+		of_property_read_u32(np, "ti,rx-dma-buffers", &rx_bufs);
+		if (omap8250_rx_dma_check(priv, rx_size, rx_bufs)) {
+			dev_warn(&pdev->dev, "invalid RX DMA config %u x %u, using %u x 1\n",
+				 rx_size, rx_bufs, dma->rx_size);
+			rx_size = dma->rx_size;
+			rx_bufs = 1;
+		}
+		priv->rx_dma_buf_size = rx_size;
+		priv->rx_dma_nbufs = rx_bufs;
 	}
 #endif
+	priv->rx_trig_fixed = priv->rx_trigger;
 
 	irq_set_status_flags(up.port.irq, IRQ_NOAUTOEN);
 	ret = devm_request_irq(&pdev->dev, up.port.irq, omap8250_irq, 0,
@@ -1588,6 +4272,9 @@ static int omap8250_probe(struct platform_device *pdev)
 		goto err;
 	}
 	priv->line = ret;
+	if (priv->rx_dma_raw)
+		omap8250_raw_register(pdev, priv);
+	omap8250_debugfs_init(priv);
 	pm_runtime_mark_last_busy(&pdev->dev);
 	pm_runtime_put_autosuspend(&pdev->dev);
 
@@ -1602,6 +4289,7 @@ err:
 	flush_work(&priv->qos_work);
 	pm_runtime_disable(&pdev->dev);
 	cpu_latency_qos_remove_request(&priv->pm_qos_request);
+	dev_pm_qos_remove_request(&priv->resume_qos);
 	return ret;
 }
 
@@ -1615,15 +4303,19 @@ static void omap8250_remove(struct platform_device *pdev)
 	if (err)
 		dev_err(&pdev->dev, "Failed to resume hardware\n");
 
+	debugfs_remove_recursive(priv->debugfs);
+	omap8250_raw_unregister(priv);
 	up = serial8250_get_port(priv->line);
 	omap_8250_shutdown(&up->port);
 	serial8250_unregister_port(priv->line);
+	omap8250_model_free(priv);
 	priv->line = -ENODEV;
 	pm_runtime_dont_use_autosuspend(&pdev->dev);
 	pm_runtime_put_sync(&pdev->dev);
 	flush_work(&priv->qos_work);
 	pm_runtime_disable(&pdev->dev);
 	cpu_latency_qos_remove_request(&priv->pm_qos_request);
+	dev_pm_qos_remove_request(&priv->resume_qos);
 	device_set_wakeup_capable(&pdev->dev, false);
 }
 
@@ -1799,11 +4491,14 @@ static int omap8250_runtime_resume(struct device *dev)
 {
 	struct omap8250_priv *priv = dev_get_drvdata(dev);
 	struct uart_8250_port *up = NULL;
+	u64 start, ns;
 
 	/* Did the hardware wake to a device IO interrupt before a wakeirq? */
 	if (atomic_read(&priv->active))
 		return 0;
 
+	start = ktime_get_ns();
+
 	if (priv->line >= 0)
 		up = serial8250_get_port(priv->line);
 
@@ -1818,7 +4513,15 @@ static int omap8250_runtime_resume(struct device *dev)
 	}
 
 	atomic_set(&priv->active, 1);
-	priv->latency = priv->calc_latency;
+
+	/* Context restore and DMA restart is what a wake adds to the first byte */
+	ns = ktime_get_ns() - start;
+	priv->stats.wake_rpm++;
+	priv->stats.wake_ns += ns;
+	priv->stats.wake_ns_max = max(priv->stats.wake_ns_max, ns);
+	WRITE_ONCE(priv->wake_ns_peak, max(priv->wake_ns_peak, ns));
+
+	priv->latency = omap8250_qos_latency(priv);
 	schedule_work(&priv->qos_work);
 
 	return 0;
@@ -1877,12 +4580,39 @@ static struct platform_driver omap8250_platform_driver = {
 		.name		= "omap8250",
 		.pm		= pm_ptr(&omap8250_dev_pm_ops),
 		.of_match_table = omap8250_dt_ids,
+		.dev_groups	= omap8250_groups,
 	},
 	.probe			= omap8250_probe,
 	.remove			= omap8250_remove,
 };
-module_platform_driver(omap8250_platform_driver);
+
+static int __init omap8250_init(void)
+{
+	int ret;
+
+	omap8250_debugfs_root = debugfs_create_dir("8250_omap", NULL);
+	debugfs_create_file("irq_timing", 0600, omap8250_debugfs_root, NULL,
+			    &omap8250_irq_timing_fops);
+
+	ret = platform_driver_register(&omap8250_platform_driver);
+	if (ret)
+		debugfs_remove_recursive(omap8250_debugfs_root);
+
+	return ret;
+}
+module_init(omap8250_init);
+
+static void __exit omap8250_exit(void)
+{
+	platform_driver_unregister(&omap8250_platform_driver);
+	debugfs_remove_recursive(omap8250_debugfs_root);
+}
+module_exit(omap8250_exit);
 
 MODULE_AUTHOR("Sebastian Andrzej Siewior");
 MODULE_DESCRIPTION("OMAP 8250 Driver");
 MODULE_LICENSE("GPL v2");
+
+#if IS_ENABLED(CONFIG_SERIAL_8250_OMAP_KUNIT_TEST)
+#include "8250_omap_kunit.c"
+#endif
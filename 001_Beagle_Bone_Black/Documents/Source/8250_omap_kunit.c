@@ -0,0 +1,788 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit tests for the 8250_omap software UART model and the PIO paths that
+ * run on top of it. Built into 8250_omap.c with
+ * CONFIG_SERIAL_8250_OMAP_KUNIT_TEST so the static helpers can be reached.
+ *
+ * The model's line timer is replaced with one that does nothing and the
+ * tests clock the wire themselves, one frame per step, handling a pending
+ * interrupt the way omap8250_irq() would. The PIO tests report MMIO
+ * accesses and interrupts per byte and fail when a change makes them
+ * worse than the current RX/TX paths allow. The cyclic RX DMA cases put a
+ * fake dmaengine channel on the same model.
+ */
+
+#include <kunit/test.h>
+
+#define OMAP8250_TEST_BYTES	1024
+
+struct omap8250_test_dma;
+
+struct omap8250_test {
+	struct omap8250_priv priv;
+	struct uart_8250_port up;
+	struct uart_state state;
+	struct omap8250_model model;
+
+	u8 rx[OMAP8250_TEST_BYTES];
+	unsigned int rx_len;
+	unsigned int irqs;
+
+	/* Bytes arriving while the driver drains the FIFO, see omap8250_test_serial_in() */
+	struct omap8250_test_dma *dma;
+	u32 arrivals;
+};
+
+static size_t omap8250_test_receive_buf(struct tty_port *port, const u8 *cp,
+					const u8 *fp, size_t count)
+{
+	struct omap8250_test *t = container_of(port, struct omap8250_test,
+					       state.port);
+
+	count = min_t(size_t, count, sizeof(t->rx) - t->rx_len);
+	memcpy(t->rx + t->rx_len, cp, count);
+	t->rx_len += count;
+
+	return count;
+}
+
+static void omap8250_test_write_wakeup(struct tty_port *port)
+{
+}
+
+static const struct tty_port_client_operations omap8250_test_client_ops = {
+	.receive_buf	= omap8250_test_receive_buf,
+	.write_wakeup	= omap8250_test_write_wakeup,
+};
+
+/* The tests clock the model themselves */
+static enum hrtimer_restart omap8250_test_line(struct hrtimer *t)
+{
+	return HRTIMER_NORESTART;
+}
+
+static int omap8250_test_init(struct kunit *test)
+{
+	struct omap8250_test *t;
+	struct uart_8250_port *up;
+	struct omap8250_model *m;
+
+	t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+
+	tty_port_init(&t->state.port);
+	t->state.port.client_ops = &omap8250_test_client_ops;
+	if (tty_port_alloc_xmit_buf(&t->state.port)) {
+		tty_port_destroy(&t->state.port);
+		return -ENOMEM;
+	}
+
+	up = &t->up;
+	spin_lock_init(&up->port.lock);
+	up->port.state = &t->state;
+	up->port.private_data = &t->priv;
+	up->port.serial_in = omap8250_serial_in;
+	up->port.serial_out = omap8250_serial_out;
+	up->tx_loadsz = OMAP8250_MODEL_FIFO;
+	up->capabilities = UART_CAP_FIFO;
+	up->lsr_save_mask = LSR_SAVE_FLAGS;
+
+	t->priv.rx_trigger = 48;
+	t->priv.tx_trigger = 16;
+
+	m = &t->model;
+	raw_spin_lock_init(&m->lock);
+	m->priv = &t->priv;
+	m->port = &up->port;
+	hrtimer_setup(&m->line, omap8250_test_line, CLOCK_MONOTONIC,
+		      HRTIMER_MODE_REL_HARD);
+	rcu_assign_pointer(t->priv.model, m);
+
+	serial_out(up, UART_FCR, UART_FCR_ENABLE_FIFO);
+	up->ier = UART_IER_RLSI | UART_IER_RDI;
+	serial_out(up, UART_IER, up->ier);
+	memset(&t->priv.stats, 0, sizeof(t->priv.stats));
+
+	test->priv = t;
+	return 0;
+}
+
+static void omap8250_test_exit(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+
+	hrtimer_cancel(&t->model.line);
+	tty_port_free_xmit_buf(&t->state.port);
+	tty_port_destroy(&t->state.port);
+}
+
+static void omap8250_test_inject(struct omap8250_test *t, u32 bytes)
+{
+	guard(raw_spinlock_irqsave)(&t->model.lock);
+	t->model.inject += bytes;
+}
+
+/* One character time on the wire, without servicing the interrupt */
+static void omap8250_test_frame(struct omap8250_test *t)
+{
+	guard(raw_spinlock_irqsave)(&t->model.lock);
+	omap8250_model_frame(&t->model);
+}
+
+static bool omap8250_test_pending(struct omap8250_test *t)
+{
+	guard(raw_spinlock_irqsave)(&t->model.lock);
+	return omap8250_model_iir(&t->model) != UART_IIR_NO_INT;
+}
+
+static bool omap8250_test_busy(struct omap8250_test *t)
+{
+	guard(raw_spinlock_irqsave)(&t->model.lock);
+	return omap8250_model_busy(&t->model);
+}
+
+/* Clock the wire and take every interrupt until the model goes idle */
+static void omap8250_test_run(struct kunit *test, struct omap8250_test *t)
+{
+	struct tty_port *tport = &t->state.port;
+	unsigned int frames = 0;
+	unsigned int iir;
+
+	while (omap8250_test_busy(t) || !kfifo_is_empty(&tport->xmit_fifo)) {
+		KUNIT_ASSERT_LT(test, frames++, 8 * OMAP8250_TEST_BYTES);
+
+		omap8250_test_frame(t);
+		if (!omap8250_test_pending(t))
+			continue;
+
+		t->irqs++;
+		iir = serial_in(&t->up, UART_IIR);
+		omap_8250_pio_handle_irq(&t->up.port, iir);
+	}
+
+	flush_work(&tport->buf.work);
+}
+
+static void omap8250_test_check_rx(struct kunit *test, struct omap8250_test *t,
+				   unsigned int bytes)
+{
+	unsigned int i;
+
+	KUNIT_ASSERT_EQ(test, t->rx_len, bytes);
+	for (i = 0; i < bytes; i++)
+		KUNIT_ASSERT_EQ_MSG(test, t->rx[i], (u8)i, "offset %u", i);
+}
+
+static void omap8250_model_test_rx_timeout(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct uart_8250_port *up = &t->up;
+	int i;
+
+	omap8250_test_inject(t, 10);
+	for (i = 0; i < 10; i++)
+		omap8250_test_frame(t);
+
+	/* Below the trigger level and not idle for long enough yet */
+	KUNIT_EXPECT_EQ(test, serial_in(up, UART_OMAP_RX_LVL), 10);
+	KUNIT_EXPECT_TRUE(test, serial_in(up, UART_LSR) & UART_LSR_DR);
+	KUNIT_EXPECT_FALSE(test, omap8250_test_pending(t));
+
+	for (i = 0; i < OMAP8250_MODEL_TIMEOUT; i++)
+		omap8250_test_frame(t);
+	KUNIT_EXPECT_EQ(test, serial_in(up, UART_IIR) & UART_IIR_ID,
+			UART_IIR_RX_TIMEOUT);
+
+	for (i = 0; i < 10; i++)
+		KUNIT_EXPECT_EQ(test, serial_in(up, UART_RX), i);
+	KUNIT_EXPECT_FALSE(test, serial_in(up, UART_LSR) & UART_LSR_DR);
+	KUNIT_EXPECT_FALSE(test, omap8250_test_pending(t));
+}
+
+static void omap8250_model_test_rx_trigger(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct uart_8250_port *up = &t->up;
+	int i;
+
+	omap8250_test_inject(t, t->priv.rx_trigger);
+	for (i = 0; i < t->priv.rx_trigger - 1; i++)
+		omap8250_test_frame(t);
+	KUNIT_EXPECT_FALSE(test, omap8250_test_pending(t));
+
+	omap8250_test_frame(t);
+	KUNIT_EXPECT_EQ(test, serial_in(up, UART_IIR) & UART_IIR_ID,
+			UART_IIR_RDI);
+}
+
+static void omap8250_model_test_overrun(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct uart_8250_port *up = &t->up;
+	int i;
+
+	omap8250_test_inject(t, OMAP8250_MODEL_FIFO + 6);
+	for (i = 0; i < OMAP8250_MODEL_FIFO + 6; i++)
+		omap8250_test_frame(t);
+
+	KUNIT_EXPECT_EQ(test, serial_in(up, UART_OMAP_RX_LVL),
+			OMAP8250_MODEL_FIFO);
+	KUNIT_EXPECT_EQ(test, t->model.rx_overruns, 6);
+	KUNIT_EXPECT_EQ(test, serial_in(up, UART_IIR) & UART_IIR_ID,
+			UART_IIR_RLSI);
+
+	/* OE is clear-on-read, the data stays */
+	KUNIT_EXPECT_TRUE(test, serial_in(up, UART_LSR) & UART_LSR_OE);
+	KUNIT_EXPECT_FALSE(test, serial_in(up, UART_LSR) & UART_LSR_OE);
+	KUNIT_EXPECT_EQ(test, serial_in(up, UART_OMAP_RX_LVL),
+			OMAP8250_MODEL_FIFO);
+}
+
+static void omap8250_model_test_loopback(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct uart_8250_port *up = &t->up;
+	u16 lsr;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		serial_out(up, UART_TX, 0xa0 + i);
+	KUNIT_EXPECT_EQ(test, serial_in(up, UART_OMAP_TX_LVL), 16);
+	KUNIT_EXPECT_FALSE(test, serial_in(up, UART_LSR) & UART_LSR_THRE);
+
+	/* The first frame only loads the shift register */
+	for (i = 0; i < 16; i++)
+		omap8250_test_frame(t);
+	lsr = serial_in(up, UART_LSR);
+	KUNIT_EXPECT_TRUE(test, lsr & UART_LSR_THRE);
+	KUNIT_EXPECT_FALSE(test, lsr & UART_LSR_TEMT);
+
+	omap8250_test_frame(t);
+	lsr = serial_in(up, UART_LSR);
+	KUNIT_EXPECT_TRUE(test, lsr & UART_LSR_TEMT);
+	KUNIT_EXPECT_EQ(test, serial_in(up, UART_OMAP_RX_LVL), 16);
+	KUNIT_EXPECT_EQ(test, t->model.tx_chars, 16);
+
+	for (i = 0; i < 16; i++)
+		KUNIT_EXPECT_EQ(test, serial_in(up, UART_RX), 0xa0 + i);
+}
+
+/*
+ * Moving the RX trigger rewrites TLR through config mode B, where offset 7
+ * is also XOFF2. With TCRTLR set that write must not reach the delimiter.
+ */
+static void omap8250_model_test_trigger_keeps_delim(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct omap8250_priv *priv = &t->priv;
+	struct uart_8250_port *up = &t->up;
+	u8 delim = 9;
+	int i;
+
+	scoped_guard(uart_port_lock_irqsave, &up->port) {
+		priv->rx_delim = delim;
+		omap8250_rx_delim_update(up, priv);
+		up->lcr = UART_LCR_WLEN8;
+		up->fcr = UART_FCR_ENABLE_FIFO;
+
+		serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
+		serial_out(up, UART_EFR, priv->efr | UART_EFR_ECB);
+		serial_out(up, UART_XOFF2, priv->xoff2);
+		serial_out(up, UART_LCR, 0);
+		serial_out(up, UART_IER, up->ier);
+		serial_out(up, UART_LCR, UART_LCR_CONF_MODE_B);
+		serial_out(up, UART_EFR, priv->efr);
+		serial_out(up, UART_LCR, up->lcr);
+
+		priv->rx_trigger = 16;
+		omap8250_update_rx_trigger(up, priv);
+	}
+
+	KUNIT_EXPECT_EQ(test, t->model.cfg[UART_XOFF2], delim);
+	KUNIT_EXPECT_EQ(test, t->model.tlr, omap8250_tlr(priv));
+	KUNIT_EXPECT_TRUE(test, t->model.cfg[UART_EFR] & UART_EFR_SCD);
+
+	/* The delimiter still ends the frame, ahead of trigger and timeout */
+	omap8250_test_inject(t, delim + 1);
+	for (i = 0; i <= delim; i++)
+		omap8250_test_frame(t);
+	KUNIT_EXPECT_EQ(test, serial_in(up, UART_IIR) & 0x3f, OMAP_UART_IIR_XOFF);
+
+	omap8250_test_run(test, t);
+	omap8250_test_check_rx(test, t, delim + 1);
+}
+
+/*
+ * The bulk RX drain costs one RX read per byte plus IIR, LSR, MSR and two
+ * RX_LVL/LSR pairs per interrupt; per-character LSR polling would double
+ * the reads.
+ */
+static void omap8250_pio_test_rx(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct omap8250_stats *st = &t->priv.stats;
+
+	omap8250_test_inject(t, OMAP8250_TEST_BYTES);
+	omap8250_test_run(test, t);
+
+	omap8250_test_check_rx(test, t, OMAP8250_TEST_BYTES);
+	KUNIT_EXPECT_EQ(test, t->up.port.icount.rx, OMAP8250_TEST_BYTES);
+	KUNIT_EXPECT_EQ(test, t->up.port.icount.overrun, 0);
+	KUNIT_EXPECT_EQ(test, st->rx_pio_bytes, OMAP8250_TEST_BYTES);
+
+	kunit_info(test, "rx: %u irqs, %llu reads, %llu writes for %u bytes\n",
+		   t->irqs, st->mmio_reads, st->mmio_writes,
+		   OMAP8250_TEST_BYTES);
+	KUNIT_EXPECT_LE(test, t->irqs,
+			DIV_ROUND_UP(OMAP8250_TEST_BYTES, t->priv.rx_trigger) + 1);
+	KUNIT_EXPECT_LE(test, st->mmio_reads,
+			OMAP8250_TEST_BYTES + 8 * t->irqs);
+	KUNIT_EXPECT_EQ(test, st->mmio_writes, 0);
+}
+
+/* An unserviced FIFO overruns once and the drain accounts for it */
+static void omap8250_pio_test_rx_overrun(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	int i;
+
+	omap8250_test_inject(t, OMAP8250_MODEL_FIFO + 1);
+	for (i = 0; i < OMAP8250_MODEL_FIFO + 1; i++)
+		omap8250_test_frame(t);
+	omap8250_test_run(test, t);
+
+	KUNIT_EXPECT_EQ(test, t->up.port.icount.overrun, 1);
+	omap8250_test_check_rx(test, t, OMAP8250_MODEL_FIFO);
+}
+
+/*
+ * TX fills whatever TX_LVL says is free, so it costs one THR write per byte
+ * plus an IIR, LSR, TX_LVL and MSR access per interrupt. The model loops
+ * the bytes back into RX, where they must arrive complete and in order.
+ */
+static void omap8250_pio_test_tx(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct omap8250_stats *st = &t->priv.stats;
+	struct uart_8250_port *up = &t->up;
+	unsigned int i;
+	u8 *buf;
+
+	buf = kunit_kmalloc(test, OMAP8250_TEST_BYTES, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, buf);
+	for (i = 0; i < OMAP8250_TEST_BYTES; i++)
+		buf[i] = i;
+	KUNIT_ASSERT_EQ(test, kfifo_in(&t->state.port.xmit_fifo, buf,
+				       OMAP8250_TEST_BYTES),
+			OMAP8250_TEST_BYTES);
+
+	scoped_guard(uart_port_lock_irqsave, &up->port) {
+		up->ier |= UART_IER_THRI;
+		serial_out(up, UART_IER, up->ier);
+	}
+	memset(st, 0, sizeof(*st));
+	omap8250_test_run(test, t);
+
+	KUNIT_EXPECT_EQ(test, t->model.tx_chars, OMAP8250_TEST_BYTES);
+	KUNIT_EXPECT_EQ(test, t->model.tx_overflows, 0);
+	KUNIT_EXPECT_EQ(test, st->tx_pio_bytes, OMAP8250_TEST_BYTES);
+	KUNIT_EXPECT_FALSE(test, up->ier & UART_IER_THRI);
+	omap8250_test_check_rx(test, t, OMAP8250_TEST_BYTES);
+
+	kunit_info(test, "tx: %u irqs, %llu reads, %llu writes for %u bytes\n",
+		   t->irqs, st->mmio_reads, st->mmio_writes,
+		   OMAP8250_TEST_BYTES);
+	KUNIT_EXPECT_LE(test, st->mmio_writes,
+			OMAP8250_TEST_BYTES + 2 * t->irqs);
+}
+
+#ifdef CONFIG_SERIAL_8250_DMA
+/*
+ * Fake cyclic RX channel. It takes a burst from the model's RX FIFO
+ * whenever the FIFO reaches the trigger level, like the UART's DMA request
+ * would. The burst lands in the ring at once, or with @lazy only once the
+ * channel is paused, which is how a burst still in flight when the IRQ
+ * polls the ring looks to the driver. Like EDMA, a paused channel latches
+ * the request and serves it on resume, reading a full burst from the RHR
+ * whatever the FIFO holds by then; reads of an empty RHR are counted in
+ * @stale. Terminating the channel drops the latched request.
+ */
+#define OMAP8250_TEST_RING	256
+#define OMAP8250_TEST_PERIOD	64
+
+struct omap8250_test_dma {
+	struct dma_device dev;
+	struct dma_chan chan;
+	struct dma_async_tx_descriptor desc;
+	struct omap8250_test *t;
+	u8 ring[OMAP8250_TEST_RING];
+	u32 pos;
+	u8 burst[OMAP8250_MODEL_FIFO];
+	u32 in_flight;
+	bool running;
+	bool paused;
+	bool latched;
+	bool lazy;
+	unsigned int submits;
+	unsigned int pauses;
+	unsigned int terminates;
+	unsigned int stale;
+};
+
+static struct omap8250_test_dma *chan_to_test_dma(struct dma_chan *chan)
+{
+	return container_of(chan, struct omap8250_test_dma, chan);
+}
+
+/* One burst out of the RHR, as many reads as the trigger level */
+static void omap8250_test_dma_take(struct omap8250_test_dma *fd)
+{
+	struct omap8250_model *m = &fd->t->model;
+	u32 burst = fd->t->priv.rx_trigger;
+
+	lockdep_assert_held(&m->lock);
+
+	while (fd->in_flight < burst) {
+		if (!m->rx_len) {
+			fd->burst[fd->in_flight++] = m->last_rx;
+			fd->stale++;
+			continue;
+		}
+		m->last_rx = m->rx[m->rx_head];
+		fd->burst[fd->in_flight++] = m->last_rx;
+		m->rx_head = (m->rx_head + 1) % OMAP8250_MODEL_FIFO;
+		m->rx_len--;
+	}
+	m->rx_idle = 0;
+}
+
+/* Returns true when the write position crossed a period boundary */
+static bool omap8250_test_dma_land(struct omap8250_test_dma *fd)
+{
+	u32 before = fd->pos / OMAP8250_TEST_PERIOD;
+	u32 i;
+
+	for (i = 0; i < fd->in_flight; i++) {
+		fd->ring[fd->pos] = fd->burst[i];
+		fd->pos = (fd->pos + 1) % OMAP8250_TEST_RING;
+	}
+	fd->in_flight = 0;
+
+	return fd->pos / OMAP8250_TEST_PERIOD != before;
+}
+
+static struct dma_async_tx_descriptor *
+omap8250_test_dma_prep_cyclic(struct dma_chan *chan, dma_addr_t buf_addr,
+			      size_t buf_len, size_t period_len,
+			      enum dma_transfer_direction dir,
+			      unsigned long flags)
+{
+	struct omap8250_test_dma *fd = chan_to_test_dma(chan);
+
+	if (fd->running || buf_len != OMAP8250_TEST_RING)
+		return NULL;
+	return &fd->desc;
+}
+
+static dma_cookie_t omap8250_test_dma_submit(struct dma_async_tx_descriptor *tx)
+{
+	struct omap8250_test_dma *fd = container_of(tx, struct omap8250_test_dma,
+						    desc);
+
+	fd->running = true;
+	fd->latched = false;
+	fd->pos = 0;
+	fd->submits++;
+	return 1;
+}
+
+static void omap8250_test_dma_issue_pending(struct dma_chan *chan)
+{
+}
+
+static enum dma_status omap8250_test_dma_tx_status(struct dma_chan *chan,
+						   dma_cookie_t cookie,
+						   struct dma_tx_state *state)
+{
+	struct omap8250_test_dma *fd = chan_to_test_dma(chan);
+
+	if (!fd->running)
+		return DMA_COMPLETE;
+	if (state)
+		state->residue = OMAP8250_TEST_RING - fd->pos;
+	return fd->paused ? DMA_PAUSED : DMA_IN_PROGRESS;
+}
+
+/* Pausing lets the burst in flight finish */
+static int omap8250_test_dma_pause(struct dma_chan *chan)
+{
+	struct omap8250_test_dma *fd = chan_to_test_dma(chan);
+
+	omap8250_test_dma_land(fd);
+	fd->paused = true;
+	fd->pauses++;
+	return 0;
+}
+
+/* A request latched while paused is served now; its period callback is left to the next poll */
+static int omap8250_test_dma_resume(struct dma_chan *chan)
+{
+	struct omap8250_test_dma *fd = chan_to_test_dma(chan);
+	struct omap8250_model *m = &fd->t->model;
+
+	fd->paused = false;
+	if (fd->latched) {
+		fd->latched = false;
+		scoped_guard(raw_spinlock_irqsave, &m->lock)
+			omap8250_test_dma_take(fd);
+		omap8250_test_dma_land(fd);
+	}
+	return 0;
+}
+
+static int omap8250_test_dma_terminate(struct dma_chan *chan)
+{
+	struct omap8250_test_dma *fd = chan_to_test_dma(chan);
+
+	fd->running = false;
+	fd->paused = false;
+	fd->latched = false;
+	fd->in_flight = 0;
+	fd->terminates++;
+	return 0;
+}
+
+static struct omap8250_test_dma *omap8250_test_dma_init(struct kunit *test,
+							bool lazy)
+{
+	struct omap8250_test *t = test->priv;
+	struct uart_8250_port *up = &t->up;
+	struct uart_8250_dma *dma = &t->priv.omap8250_dma;
+	struct omap8250_test_dma *fd;
+	int ret;
+
+	fd = kunit_kzalloc(test, sizeof(*fd), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, fd);
+
+	fd->t = t;
+	fd->lazy = lazy;
+	fd->dev.device_prep_dma_cyclic = omap8250_test_dma_prep_cyclic;
+	fd->dev.device_issue_pending = omap8250_test_dma_issue_pending;
+	fd->dev.device_tx_status = omap8250_test_dma_tx_status;
+	fd->dev.device_pause = omap8250_test_dma_pause;
+	fd->dev.device_resume = omap8250_test_dma_resume;
+	fd->dev.device_terminate_all = omap8250_test_dma_terminate;
+	fd->chan.device = &fd->dev;
+	fd->desc.tx_submit = omap8250_test_dma_submit;
+
+	dma->rxchan = &fd->chan;
+	dma->rx_buf = fd->ring;
+	dma->rx_size = OMAP8250_TEST_RING;
+	spin_lock_init(&t->priv.rx_dma_lock);
+	t->priv.rx_dma_cyclic = true;
+	t->priv.rx_dma_period = OMAP8250_TEST_PERIOD;
+	t->priv.habit |= UART_HAS_RHR_IT_DIS;
+	up->dma = dma;
+
+	scoped_guard(uart_port_lock_irqsave, &up->port)
+		ret = omap_8250_rx_dma(up);
+	KUNIT_ASSERT_EQ(test, ret, 0);
+	KUNIT_ASSERT_TRUE(test, fd->running);
+
+	return fd;
+}
+
+/* The DMA request: take a burst once the FIFO holds the trigger level */
+static void omap8250_test_dma_request(struct omap8250_test *t,
+				      struct omap8250_test_dma *fd)
+{
+	struct omap8250_model *m = &t->model;
+	bool period = false;
+
+	scoped_guard(raw_spinlock_irqsave, &m->lock) {
+		if (!fd->running || fd->in_flight || m->rx_len < t->priv.rx_trigger)
+			return;
+		if (fd->paused) {
+			fd->latched = true;
+			return;
+		}
+
+		omap8250_test_dma_take(fd);
+		if (!fd->lazy)
+			period = omap8250_test_dma_land(fd);
+	}
+
+	if (period && fd->desc.callback)
+		fd->desc.callback(fd->desc.callback_param);
+}
+
+/*
+ * While @arrivals is set, the first RHR read lets that many more bytes
+ * come in and raises the DMA request for them, as if the line kept going
+ * while the interrupt handler was draining the FIFO.
+ */
+static u32 omap8250_test_serial_in(struct uart_port *port, unsigned int offset)
+{
+	struct omap8250_test *t = container_of(port, struct omap8250_test, up.port);
+	u32 frames;
+
+	if (offset == UART_RX && t->arrivals) {
+		frames = t->arrivals;
+		t->arrivals = 0;
+		omap8250_test_inject(t, frames);
+		while (frames--)
+			omap8250_test_frame(t);
+		omap8250_test_dma_request(t, t->dma);
+	}
+
+	return omap8250_serial_in(port, offset);
+}
+
+static void omap8250_test_dma_run(struct kunit *test, struct omap8250_test *t,
+				  struct omap8250_test_dma *fd)
+{
+	struct tty_port *tport = &t->state.port;
+	unsigned int frames = 0;
+
+	while (omap8250_test_busy(t)) {
+		KUNIT_ASSERT_LT(test, frames++, 8 * OMAP8250_TEST_BYTES);
+
+		omap8250_test_frame(t);
+		omap8250_test_dma_request(t, fd);
+		if (!omap8250_test_pending(t))
+			continue;
+
+		t->irqs++;
+		omap_8250_dma_handle_irq(&t->up.port);
+	}
+
+	flush_work(&tport->buf.work);
+}
+
+/*
+ * A timeout with a burst still in flight: the ring has to be collected
+ * with the channel stopped, before PIO drains the FIFO tail, or the tail
+ * overtakes the burst.
+ */
+static void omap8250_dma_test_cyclic_tail_order(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct omap8250_test_dma *fd = omap8250_test_dma_init(test, true);
+	u32 bytes = t->priv.rx_trigger + 4;
+
+	omap8250_test_inject(t, bytes);
+	omap8250_test_dma_run(test, t, fd);
+
+	omap8250_test_check_rx(test, t, bytes);
+	KUNIT_EXPECT_EQ(test, t->irqs, 1);
+	KUNIT_EXPECT_EQ(test, fd->pauses, 1);
+	KUNIT_EXPECT_EQ(test, fd->terminates, 1);
+	KUNIT_EXPECT_EQ(test, fd->submits, 2);
+	KUNIT_EXPECT_TRUE(test, fd->running);
+	KUNIT_EXPECT_FALSE(test, fd->paused);
+	KUNIT_EXPECT_EQ(test, t->priv.rx_dma_bytes, t->priv.rx_trigger);
+}
+
+/*
+ * A burst worth of bytes comes in while PIO drains the tail. Their DMA
+ * request must not survive into the restarted ring: the drain takes them,
+ * and a burst served afterwards would read an empty RHR into the ring.
+ */
+static void omap8250_dma_test_cyclic_drain_arrivals(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct omap8250_test_dma *fd = omap8250_test_dma_init(test, false);
+	u32 bytes = t->priv.rx_trigger + 4;
+
+	t->dma = fd;
+	t->arrivals = t->priv.rx_trigger;
+	t->up.port.serial_in = omap8250_test_serial_in;
+
+	omap8250_test_inject(t, bytes);
+	omap8250_test_dma_run(test, t, fd);
+
+	KUNIT_EXPECT_EQ(test, t->arrivals, 0);
+	KUNIT_EXPECT_EQ(test, fd->stale, 0);
+	KUNIT_EXPECT_FALSE(test, fd->latched);
+	omap8250_test_check_rx(test, t, bytes + t->priv.rx_trigger);
+	KUNIT_EXPECT_EQ(test, t->irqs, 1);
+	KUNIT_EXPECT_TRUE(test, fd->running);
+	KUNIT_EXPECT_EQ(test, t->priv.rx_dma_bytes, t->priv.rx_trigger);
+}
+
+/* A stream wrapping the ring several times, handed over by the period callback */
+static void omap8250_dma_test_cyclic_stream(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct omap8250_test_dma *fd = omap8250_test_dma_init(test, false);
+	u32 tail = OMAP8250_TEST_BYTES % t->priv.rx_trigger;
+
+	omap8250_test_inject(t, OMAP8250_TEST_BYTES);
+	omap8250_test_dma_run(test, t, fd);
+
+	omap8250_test_check_rx(test, t, OMAP8250_TEST_BYTES);
+	KUNIT_EXPECT_EQ(test, t->up.port.icount.rx, OMAP8250_TEST_BYTES);
+	KUNIT_EXPECT_EQ(test, t->priv.rx_dma_bytes, OMAP8250_TEST_BYTES - tail);
+	KUNIT_EXPECT_EQ(test, t->irqs, 1);
+	KUNIT_EXPECT_EQ(test, fd->terminates, 1);
+	KUNIT_EXPECT_EQ(test, fd->stale, 0);
+	KUNIT_EXPECT_TRUE(test, fd->running);
+}
+
+/*
+ * A delimiter that ends a full burst: the DMA has emptied the FIFO before
+ * the interrupt is taken, and the ring must still be handed over.
+ */
+static void omap8250_dma_test_cyclic_delim(struct kunit *test)
+{
+	struct omap8250_test *t = test->priv;
+	struct omap8250_test_dma *fd = omap8250_test_dma_init(test, false);
+	struct uart_8250_port *up = &t->up;
+	u32 bytes = t->priv.rx_trigger;
+
+	scoped_guard(raw_spinlock_irqsave, &t->model.lock) {
+		t->model.cfg[UART_EFR] = UART_EFR_SCD;
+		t->model.cfg[UART_XOFF2] = bytes - 1;
+	}
+	scoped_guard(uart_port_lock_irqsave, &up->port) {
+		up->ier |= OMAP_UART_IER_XOFF;
+		serial_out(up, UART_IER, up->ier);
+	}
+
+	omap8250_test_inject(t, bytes);
+	omap8250_test_dma_run(test, t, fd);
+
+	omap8250_test_check_rx(test, t, bytes);
+	KUNIT_EXPECT_EQ(test, t->irqs, 1);
+	KUNIT_EXPECT_EQ(test, t->priv.stats.rx_delim_irqs, 1);
+	KUNIT_EXPECT_EQ(test, t->priv.rx_dma_bytes, bytes);
+}
+#endif
+
+static struct kunit_case omap8250_model_test_cases[] = {
+	KUNIT_CASE(omap8250_model_test_rx_timeout),
+	KUNIT_CASE(omap8250_model_test_rx_trigger),
+	KUNIT_CASE(omap8250_model_test_overrun),
+	KUNIT_CASE(omap8250_model_test_loopback),
+	KUNIT_CASE(omap8250_model_test_trigger_keeps_delim),
+	KUNIT_CASE(omap8250_pio_test_rx),
+	KUNIT_CASE(omap8250_pio_test_rx_overrun),
+	KUNIT_CASE(omap8250_pio_test_tx),
+#ifdef CONFIG_SERIAL_8250_DMA
+	KUNIT_CASE(omap8250_dma_test_cyclic_tail_order),
+	KUNIT_CASE(omap8250_dma_test_cyclic_drain_arrivals),
+	KUNIT_CASE(omap8250_dma_test_cyclic_stream),
+	KUNIT_CASE(omap8250_dma_test_cyclic_delim),
+#endif
+	{}
+};
+
+static struct kunit_suite omap8250_model_test_suite = {
+	.name = "8250_omap_model",
+	.init = omap8250_test_init,
+	.exit = omap8250_test_exit,
+	.test_cases = omap8250_model_test_cases,
+};
+
+kunit_test_suites(&omap8250_model_test_suite);
@@ -3275,6 +3275,31 @@ static void serial8250_console_fifo_write(struct uart_8250_port *up,
 	fifo_wait_for_lsr(up, tx_count);
 }
 
+static bool serial8250_console_use_fifo(struct uart_8250_port *up)
+{
+	struct uart_port *port = &up->port;
+
+	return (up->capabilities & UART_CAP_FIFO) &&
+		/*
+		 * BCM283x requires to check the fifo
+		 * after each byte.
+		 */
+		!(up->capabilities & UART_CAP_MINI) &&
+		/*
+		 * tx_loadsz contains the transmit fifo size
+		 */
+		up->tx_loadsz > 1 &&
+		(up->fcr & UART_FCR_ENABLE_FIFO) &&
+		port->state &&
+		test_bit(TTY_PORT_INITIALIZED, &port->state->port.iflags) &&
+		/*
+		 * After we put a data in the fifo, the controller will send
+		 * it regardless of the CTS state. Therefore, only use fifo
+		 * if we don't use control flow.
+		 */
+		!(up->port.flags & UPF_CONS_FLOW);
+}
+
 /*
  *	Print a string to the serial port trying not to disturb
  *	any possible real use of the port...
@@ -3318,25 +3343,7 @@ void serial8250_console_write(struct uart_8250_port *up, const char *s,
 		mdelay(port->rs485.delay_rts_before_send);
 	}
 
-	use_fifo = (up->capabilities & UART_CAP_FIFO) &&
-		/*
-		 * BCM283x requires to check the fifo
-		 * after each byte.
-		 */
-		!(up->capabilities & UART_CAP_MINI) &&
-		/*
-		 * tx_loadsz contains the transmit fifo size
-		 */
-		up->tx_loadsz > 1 &&
-		(up->fcr & UART_FCR_ENABLE_FIFO) &&
-		port->state &&
-		test_bit(TTY_PORT_INITIALIZED, &port->state->port.iflags) &&
-		/*
-		 * After we put a data in the fifo, the controller will send
-		 * it regardless of the CTS state. Therefore, only use fifo
-		 * if we don't use control flow.
-		 */
-		!(up->port.flags & UPF_CONS_FLOW);
+	use_fifo = serial8250_console_use_fifo(up);
 
 	if (likely(use_fifo))
 		serial8250_console_fifo_write(up, s, count);
@@ -3371,6 +3378,139 @@ void serial8250_console_write(struct uart_8250_port *up, const char *s,
 		uart_port_unlock_irqrestore(port, flags);
 }
 
+/*
+ * nbcon variants of the above. The FIFO is refilled one load at a time and
+ * ownership is checked before each load: a handover or takeover invalidates
+ * wctxt->outbuf, the new owner reprints the record.
+ */
+static void serial8250_console_fifo_write_nbcon(struct uart_8250_port *up,
+						struct nbcon_write_context *wctxt)
+{
+	const char *s = wctxt->outbuf;
+	const char *end = s + wctxt->len;
+	unsigned int fifosize = up->tx_loadsz;
+	struct uart_port *port = &up->port;
+	unsigned int tx_count = 0;
+	bool cr_sent = false;
+	unsigned int i;
+
+	while (s != end) {
+		/* Allow timeout for each byte of a possibly full FIFO */
+		fifo_wait_for_lsr(up, fifosize);
+
+		if (!nbcon_can_proceed(wctxt))
+			return;
+
+		for (i = 0; i < fifosize && s != end; ++i) {
+			if (*s == '\n' && !cr_sent) {
+				serial8250_console_putchar(port, '\r');
+				cr_sent = true;
+			} else {
+				serial8250_console_putchar(port, *s++);
+				cr_sent = false;
+			}
+		}
+		tx_count = i;
+	}
+
+	fifo_wait_for_lsr(up, tx_count);
+}
+
+static void serial8250_console_byte_write_nbcon(struct uart_8250_port *up,
+						struct nbcon_write_context *wctxt)
+{
+	struct uart_port *port = &up->port;
+	unsigned int i;
+
+	for (i = 0; i < wctxt->len; i++) {
+		if (!nbcon_can_proceed(wctxt))
+			return;
+		if (wctxt->outbuf[i] == '\n')
+			serial8250_console_wait_putchar(port, '\r');
+		serial8250_console_wait_putchar(port, wctxt->outbuf[i]);
+	}
+}
+
+/*
+ *	nbcon console write. The printk core calls this from its printing
+ *	kthread with the port lock held (@atomic false), or with only console
+ *	ownership in emergency and panic context (@atomic true), so printk()
+ *	callers no longer spin on the UART themselves. Port state is only
+ *	touched inside unsafe sections; the characters themselves are sent in
+ *	a safe section where a more important context may take over.
+ */
+void serial8250_console_write_nbcon(struct uart_8250_port *up,
+				    struct nbcon_write_context *wctxt,
+				    bool atomic)
+{
+	struct uart_8250_em485 *em485 = up->em485;
+	struct uart_port *port = &up->port;
+	unsigned int ier;
+	bool use_fifo;
+
+	touch_nmi_watchdog();
+
+	if (!nbcon_enter_unsafe(wctxt))
+		return;
+
+	/*
+	 *	First save the IER then disable the interrupts
+	 */
+	ier = serial_port_in(port, UART_IER);
+	serial8250_clear_IER(up);
+
+	/* check scratch reg to see if port powered off during system sleep */
+	if (up->canary && (up->canary != serial_port_in(port, UART_SCR))) {
+		serial8250_console_restore(up);
+		up->canary = 0;
+	}
+
+	if (em485) {
+		if (em485->tx_stopped)
+			up->rs485_start_tx(up, false);
+		mdelay(port->rs485.delay_rts_before_send);
+	}
+
+	use_fifo = serial8250_console_use_fifo(up);
+
+	if (!nbcon_exit_unsafe(wctxt))
+		goto reacquire;
+
+	if (likely(use_fifo))
+		serial8250_console_fifo_write_nbcon(up, wctxt);
+	else
+		serial8250_console_byte_write_nbcon(up, wctxt);
+
+reacquire:
+	/* Even if the record was lost, the port has to be put back */
+	while (!nbcon_enter_unsafe(wctxt))
+		nbcon_reacquire_nobuf(wctxt);
+
+	/*
+	 *	Finally, wait for transmitter to become empty
+	 *	and restore the IER
+	 */
+	wait_for_xmitr(up, UART_LSR_BOTH_EMPTY);
+
+	if (em485) {
+		mdelay(port->rs485.delay_rts_after_send);
+		if (em485->tx_stopped)
+			up->rs485_stop_tx(up, false);
+	}
+
+	serial_port_out(port, UART_IER, ier);
+
+	/*
+	 *	Modem status changes seen meanwhile are replayed under the port
+	 *	lock. An atomic writer does not hold it, it leaves them in
+	 *	msr_saved_flags for the next interrupt instead.
+	 */
+	if (up->msr_saved_flags && !atomic)
+		serial8250_modem_status(up);
+
+	nbcon_exit_unsafe(wctxt);
+}
+
 static unsigned int probe_baud(struct uart_port *port)
 {
 	unsigned char lcr, dll, dlm;
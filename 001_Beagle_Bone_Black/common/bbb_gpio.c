@@ -0,0 +1,326 @@
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/gpio/consumer.h>
+#include <linux/gpio/driver.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/mutex.h>
+#include <linux/bitmap.h>
+
+#include "bbb_gpio.h"
+
+static bool fastpath;
+module_param(fastpath, bool, 0444);
+MODULE_PARM_DESC(fastpath, "Drive buses on always-on banks through SETDATAOUT/CLEARDATAOUT directly");
+
+static struct dentry *bbb_gpio_dir;
+static LIST_HEAD(bbb_gpio_buses);
+static DEFINE_MUTEX(bbb_gpio_lock);
+
+static u32 bbb_gpio_mmio_read(struct bbb_gpio_bank *bank, u32 reg)
+{
+    return readl_relaxed(bank->base + reg);
+}
+
+/*
+ * Stores to one device are not reordered against each other, so no barrier
+ * is needed between the CLEARDATAOUT and SETDATAOUT of a bus write.
+ */
+static void bbb_gpio_mmio_write(struct bbb_gpio_bank *bank, u32 reg, u32 val)
+{
+    writel_relaxed(val, bank->base + reg);
+}
+
+static const struct bbb_gpio_ops bbb_gpio_mmio_ops = {
+    .read = bbb_gpio_mmio_read,
+    .write = bbb_gpio_mmio_write,
+};
+
+static u32 bbb_gpio_fake_read(struct bbb_gpio_bank *bank, u32 reg)
+{
+    return bank->regs[reg / 4];
+}
+
+/* Same semantics as the hardware: SET/CLEAR only touch the bits written as 1 */
+static void bbb_gpio_fake_write(struct bbb_gpio_bank *bank, u32 reg, u32 val)
+{
+    switch (reg) {
+    case BBB_GPIO_SETDATAOUT:
+        bank->regs[BBB_GPIO_DATAOUT / 4] |= val;
+        break;
+    case BBB_GPIO_CLEARDATAOUT:
+        bank->regs[BBB_GPIO_DATAOUT / 4] &= ~val;
+        break;
+    default:
+        bank->regs[reg / 4] = val;
+        break;
+    }
+}
+
+static const struct bbb_gpio_ops bbb_gpio_fake_ops = {
+    .read = bbb_gpio_fake_read,
+    .write = bbb_gpio_fake_write,
+};
+
+/* The gpio-omap bank device behind @desc and the line's bit in that bank */
+static struct device *bbb_gpio_bank_of(struct gpio_desc *desc, u32 *bit)
+{
+    struct gpio_device *gdev = gpiod_to_gpio_device(desc);
+    struct device *parent = gpio_device_to_device(gdev)->parent;
+
+    if (!parent || !dev_is_platform(parent) ||
+        !of_device_is_compatible(parent->of_node, "ti,omap4-gpio"))
+        return NULL;
+
+    *bit = BIT(desc_to_gpio(desc) - gpio_device_get_base(gdev));
+    return parent;
+}
+
+/* Index of the bank behind @dev in @bus, added on first use */
+static int bbb_gpio_bank_index(struct bbb_gpio_bus *bus, struct device *dev)
+{
+    unsigned int b;
+
+    for (b = 0; b < bus->nbanks; b++)
+        if (bus->banks[b].dev == dev)
+            return b;
+
+    if (bus->nbanks == BBB_GPIO_BANKS)
+        return -E2BIG;
+    bus->banks[bus->nbanks].dev = dev;
+    return bus->nbanks++;
+}
+
+static void bbb_gpio_unmap(struct bbb_gpio_bus *bus)
+{
+    unsigned int b;
+
+    for (b = 0; b < bus->nbanks; b++)
+        if (bus->banks[b].base)
+            iounmap(bus->banks[b].base);
+    memset(bus->banks, 0, sizeof(bus->banks));
+    bus->nbanks = 0;
+}
+
+/*
+ * Only plain push-pull outputs on non-sleeping gpio-omap banks qualify,
+ * each bank is mapped once however many of its lines the bus uses. Going
+ * around gpio-omap is safe because SETDATAOUT/CLEARDATAOUT need no
+ * read-modify-write, so other users of a bank are never clobbered, and
+ * the bank stays powered while any of its lines is requested.
+ *
+ * gpio-omap keeps its own copy of DATAOUT, which these stores do not
+ * update, and writes it back when a bank comes out of a context-losing
+ * idle, reverting the lines. So only banks marked ti,gpio-always-on, whose
+ * context gpio-omap never restores, are used; a bus with a line anywhere
+ * else stays on gpiolib.
+ */
+static int bbb_gpio_map(struct bbb_gpio_bus *bus)
+{
+    struct bbb_gpio_bank *bank;
+    struct resource *res;
+    struct device *dev;
+    unsigned int i, b;
+    int idx;
+
+    for (i = 0; i < bus->num; i++) {
+        if (gpiod_cansleep(bus->descs[i]))
+            return -EOPNOTSUPP;
+
+        dev = bbb_gpio_bank_of(bus->descs[i], &bus->bit[i]);
+        if (!dev)
+            return -ENODEV;
+        if (!of_property_read_bool(dev->of_node, "ti,gpio-always-on")) {
+            dev_info(bus->dev, "bbb_gpio: %pOF loses context\n", dev->of_node);
+            return -EOPNOTSUPP;
+        }
+        idx = bbb_gpio_bank_index(bus, dev);
+        if (idx < 0)
+            return idx;
+        bus->bank[i] = idx;
+    }
+
+    for (b = 0; b < bus->nbanks; b++) {
+        bank = &bus->banks[b];
+        res = platform_get_resource(to_platform_device(bank->dev), IORESOURCE_MEM, 0);
+        if (!res || resource_size(res) < BBB_GPIO_REGS_SIZE)
+            return -ENODEV;
+
+        /* gpio-omap owns the region, so map it without requesting it again */
+        bank->base = ioremap(res->start, BBB_GPIO_REGS_SIZE);
+        if (!bank->base)
+            return -ENOMEM;
+
+        bank->phys = res->start;
+        bank->ops = &bbb_gpio_mmio_ops;
+    }
+    return 0;
+}
+
+static void bbb_gpio_bus_release(void *data)
+{
+    struct bbb_gpio_bus *bus = data;
+
+    mutex_lock(&bbb_gpio_lock);
+    list_del(&bus->node);
+    mutex_unlock(&bbb_gpio_lock);
+
+    bbb_gpio_unmap(bus);
+}
+
+int devm_bbb_gpio_bus_init(struct device *dev, struct bbb_gpio_bus *bus,
+                           struct gpio_desc **descs, unsigned int num)
+{
+    unsigned int i;
+    int ret;
+
+    if (!num || num > BBB_GPIO_BUS_MAX)
+        return -EINVAL;
+
+    memset(bus, 0, sizeof(*bus));
+    bus->dev = dev;
+    bus->num = num;
+    for (i = 0; i < num; i++) {
+        bus->descs[i] = descs[i];
+        if (gpiod_is_active_low(descs[i]))
+            bus->active_low |= BIT(i);
+        if (gpiod_get_value(descs[i]) > 0)
+            bus->state |= BIT(i);
+    }
+
+    if (fastpath) {
+        ret = bbb_gpio_map(bus);
+        if (ret) {
+            bbb_gpio_unmap(bus);
+            dev_info(dev, "bbb_gpio: %u lines stay on gpiolib (%d)\n", num, ret);
+        }
+        bus->fast = !ret;
+    }
+
+    mutex_lock(&bbb_gpio_lock);
+    list_add_tail(&bus->node, &bbb_gpio_buses);
+    mutex_unlock(&bbb_gpio_lock);
+
+    return devm_add_action_or_reset(dev, bbb_gpio_bus_release, bus);
+}
+EXPORT_SYMBOL_GPL(devm_bbb_gpio_bus_init);
+
+/*
+ * Bus over in-memory register blocks: @regs[n] stands in for gpio<n> and
+ * must hold BBB_GPIO_REGS_SIZE bytes. Line i is AM335x GPIO @gpios[i],
+ * i.e. 32 * bank + bit, so <&gpio2 5> is 69. Nothing to release.
+ */
+void bbb_gpio_bus_init_fake(struct bbb_gpio_bus *bus, u32 *regs[BBB_GPIO_BANKS],
+                            const unsigned int *gpios, unsigned int num,
+                            unsigned long active_low)
+{
+    u32 *bank_regs;
+    unsigned int i, b;
+
+    memset(bus, 0, sizeof(*bus));
+    INIT_LIST_HEAD(&bus->node);
+    bus->num = min_t(unsigned int, num, BBB_GPIO_BUS_MAX);
+    for (i = 0; i < bus->num; i++) {
+        bank_regs = regs[(gpios[i] / 32) % BBB_GPIO_BANKS];
+        for (b = 0; b < bus->nbanks; b++)
+            if (bus->banks[b].regs == bank_regs)
+                break;
+        if (b == bus->nbanks) {
+            bus->banks[b].regs = bank_regs;
+            bus->banks[b].ops = &bbb_gpio_fake_ops;
+            bus->nbanks++;
+        }
+        bus->bank[i] = b;
+        bus->bit[i] = BIT(gpios[i] % 32);
+    }
+    bus->active_low = active_low & GENMASK(bus->num - 1, 0);
+    bus->fast = true;
+}
+EXPORT_SYMBOL_GPL(bbb_gpio_bus_init_fake);
+
+/* Sets the lines in @mask to their bit in @values. Callers serialise per bus. */
+void bbb_gpio_bus_set(struct bbb_gpio_bus *bus, unsigned long values, unsigned long mask)
+{
+    struct gpio_desc *descs[BBB_GPIO_BUS_MAX];
+    u32 set[BBB_GPIO_BANKS] = {}, clr[BBB_GPIO_BANKS] = {};
+    unsigned long phys, vals = 0;
+    struct bbb_gpio_bank *bank;
+    unsigned int i, n = 0;
+
+    mask &= GENMASK(bus->num - 1, 0);
+    bus->state = (bus->state & ~mask) | (values & mask);
+
+    if (!bus->fast) {
+        for_each_set_bit(i, &mask, bus->num) {
+            if (values & BIT(i))
+                vals |= BIT(n);
+            descs[n++] = bus->descs[i];
+        }
+        gpiod_set_array_value(n, descs, NULL, &vals);
+        bus->slow_writes++;
+        return;
+    }
+
+    phys = (values ^ bus->active_low) & mask;
+    for_each_set_bit(i, &mask, bus->num) {
+        if (phys & BIT(i))
+            set[bus->bank[i]] |= bus->bit[i];
+        else
+            clr[bus->bank[i]] |= bus->bit[i];
+    }
+
+    for (i = 0; i < bus->nbanks; i++) {
+        bank = &bus->banks[i];
+        if (clr[i])
+            bank->ops->write(bank, BBB_GPIO_CLEARDATAOUT, clr[i]);
+        if (set[i])
+            bank->ops->write(bank, BBB_GPIO_SETDATAOUT, set[i]);
+    }
+    bus->fast_writes++;
+}
+EXPORT_SYMBOL_GPL(bbb_gpio_bus_set);
+
+static int buses_show(struct seq_file *s, void *unused)
+{
+    struct bbb_gpio_bus *bus;
+    unsigned int b;
+
+    seq_printf(s, "fastpath %d\n", fastpath);
+    mutex_lock(&bbb_gpio_lock);
+    list_for_each_entry(bus, &bbb_gpio_buses, node) {
+        seq_printf(s, "%-20s lines %-2u %-7s", dev_name(bus->dev), bus->num,
+                   bus->fast ? "mmio" : "gpiolib");
+        for (b = 0; bus->fast && b < bus->nbanks; b++)
+            seq_printf(s, " bank %pa", &bus->banks[b].phys);
+        seq_printf(s, " state 0x%04lx fast_writes %lu slow_writes %lu\n",
+                   bus->state, bus->fast_writes, bus->slow_writes);
+    }
+    mutex_unlock(&bbb_gpio_lock);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(buses);
+
+static int __init bbb_gpio_init(void)
+{
+    bbb_gpio_dir = debugfs_create_dir("bbb_gpio", NULL);
+    debugfs_create_file("buses", 0444, bbb_gpio_dir, NULL, &buses_fops);
+
+    pr_info("bbb_gpio loaded, fastpath %s\n", fastpath ? "on" : "off");
+    return 0;
+}
+
+static void __exit bbb_gpio_exit(void)
+{
+    debugfs_remove_recursive(bbb_gpio_dir);
+    pr_info("bbb_gpio unloaded\n");
+}
+
+module_init(bbb_gpio_init);
+module_exit(bbb_gpio_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Anis");
+MODULE_DESCRIPTION("AM335x GPIO bank fast path for bit-banged buses");
@@ -0,0 +1,72 @@
+#ifndef BBB_GPIO_H
+#define BBB_GPIO_H
+
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/gpio/consumer.h>
+
+#define BBB_GPIO_BUS_MAX 16
+#define BBB_GPIO_BANKS   4      /* gpio0..gpio3 */
+
+/* AM335x GPIO bank registers (TRM, GPIO Registers) */
+#define BBB_GPIO_OE             0x134
+#define BBB_GPIO_DATAIN         0x138
+#define BBB_GPIO_DATAOUT        0x13C
+#define BBB_GPIO_CLEARDATAOUT   0x190
+#define BBB_GPIO_SETDATAOUT     0x194
+#define BBB_GPIO_REGS_SIZE      0x198
+
+struct bbb_gpio_bank;
+
+/* Register backend: the mapped bank on the board, a plain u32 array in the KUnit tests */
+struct bbb_gpio_ops {
+    u32 (*read)(struct bbb_gpio_bank *bank, u32 reg);
+    void (*write)(struct bbb_gpio_bank *bank, u32 reg, u32 val);
+};
+
+struct bbb_gpio_bank {
+    const struct bbb_gpio_ops *ops;
+    void __iomem *base;
+    u32 *regs;
+    phys_addr_t phys;
+    struct device *dev;
+};
+
+/*
+ * A group of output lines driven together. Bit i of every value/mask is
+ * descs[i], in logical (active-high) terms. Line i sits at bit[i] of
+ * banks[bank[i]]. With the fast path enabled and every line on a
+ * ti,gpio-always-on bank, a write is one CLEARDATAOUT and/or one
+ * SETDATAOUT store per bank it touches, otherwise it falls back to
+ * gpiolib. Banks are written one after another, so lines on different
+ * banks do not switch in the same bus cycle.
+ */
+struct bbb_gpio_bus {
+    struct device *dev;
+    unsigned int num;
+    struct gpio_desc *descs[BBB_GPIO_BUS_MAX];
+    struct bbb_gpio_bank banks[BBB_GPIO_BANKS];
+    unsigned int nbanks;
+    bool fast;
+    u8 bank[BBB_GPIO_BUS_MAX];
+    u32 bit[BBB_GPIO_BUS_MAX];
+    unsigned long active_low;
+    unsigned long state;
+    unsigned long fast_writes;
+    unsigned long slow_writes;
+    struct list_head node;
+};
+
+int devm_bbb_gpio_bus_init(struct device *dev, struct bbb_gpio_bus *bus,
+                           struct gpio_desc **descs, unsigned int num);
+void bbb_gpio_bus_init_fake(struct bbb_gpio_bus *bus, u32 *regs[BBB_GPIO_BANKS],
+                            const unsigned int *gpios, unsigned int num,
+                            unsigned long active_low);
+void bbb_gpio_bus_set(struct bbb_gpio_bus *bus, unsigned long values, unsigned long mask);
+
+static inline void bbb_gpio_bus_set_line(struct bbb_gpio_bus *bus, unsigned int line, int value)
+{
+    bbb_gpio_bus_set(bus, value ? BIT(line) : 0, BIT(line));
+}
+
+#endif
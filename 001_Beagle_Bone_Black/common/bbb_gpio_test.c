@@ -0,0 +1,209 @@
+/*
+ * KUnit tests for the bbb_gpio fast path, run against in-memory banks.
+ * Load after bbb_gpio on a kernel with CONFIG_KUNIT; results are in
+ * /sys/kernel/debug/kunit/bbb_gpio/results.
+ */
+
+#include <kunit/test.h>
+#include <linux/module.h>
+#include <linux/bitmap.h>
+
+#include "bbb_gpio.h"
+
+#define BBB_GPIO_TEST_WRITES 4096
+
+/* Bit 31 of every bank stands for a line owned by someone else */
+#define BBB_GPIO_TEST_FOREIGN BIT(31)
+
+struct bbb_gpio_wiring {
+    const char *name;
+    unsigned int gpios[BBB_GPIO_BUS_MAX];
+    unsigned int num;
+    unsigned long active_low;
+    unsigned int nbanks;
+};
+
+/*
+ * The buses of the drivers in this tree, as wired in their overlays, plus
+ * one spread over three banks with active-low lines.
+ */
+static const struct bbb_gpio_wiring bbb_gpio_wirings[] = {
+    /* RS, EN, D4-D7: gpio2 2 3 5 4, gpio1 13 12 */
+    { "lcd16x2", { 66, 67, 69, 68, 45, 44 }, 6, 0, 2 },
+    { "traffic_led", { 66, 67, 69 }, 3, 0, 1 },
+    { "usr_led", { 53, 54, 55, 56 }, 4, 0, 1 },
+    { "three_banks", { 3, 40, 97, 4, 41, 98, 12 }, 7, BIT(1) | BIT(5), 3 },
+};
+
+static void bbb_gpio_wiring_desc(const struct bbb_gpio_wiring *tc, char *desc)
+{
+    strscpy(desc, tc->name, KUNIT_PARAM_DESC_SIZE);
+}
+
+KUNIT_ARRAY_PARAM(bbb_gpio_wirings, bbb_gpio_wirings, bbb_gpio_wiring_desc);
+
+struct bbb_gpio_test {
+    u32 regs[BBB_GPIO_BANKS][BBB_GPIO_REGS_SIZE / 4];
+    u32 expect[BBB_GPIO_BANKS];
+    struct bbb_gpio_bus bus;
+    const struct bbb_gpio_wiring *tc;
+};
+
+static u32 bbb_gpio_test_dataout(struct bbb_gpio_test *t, unsigned int bank)
+{
+    return t->regs[bank][BBB_GPIO_DATAOUT / 4];
+}
+
+/* Fake bus for @tc with every line low and only the foreign line set */
+static struct bbb_gpio_test *bbb_gpio_test_bus(struct kunit *test,
+                                               const struct bbb_gpio_wiring *tc)
+{
+    u32 *regs[BBB_GPIO_BANKS];
+    struct bbb_gpio_test *t;
+    unsigned int b, i;
+
+    t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, t);
+
+    t->tc = tc;
+    for (b = 0; b < BBB_GPIO_BANKS; b++) {
+        t->regs[b][BBB_GPIO_DATAOUT / 4] = BBB_GPIO_TEST_FOREIGN;
+        t->expect[b] = BBB_GPIO_TEST_FOREIGN;
+        regs[b] = t->regs[b];
+    }
+    /* Active-low lines start deasserted, i.e. high */
+    for (i = 0; i < tc->num; i++) {
+        if (tc->active_low & BIT(i)) {
+            t->regs[tc->gpios[i] / 32][BBB_GPIO_DATAOUT / 4] |= BIT(tc->gpios[i] % 32);
+            t->expect[tc->gpios[i] / 32] |= BIT(tc->gpios[i] % 32);
+        }
+    }
+
+    bbb_gpio_bus_init_fake(&t->bus, regs, tc->gpios, tc->num, tc->active_low);
+    return t;
+}
+
+/* Expected DATAOUT of every bank after a write, computed line by line */
+static void bbb_gpio_test_expect(struct bbb_gpio_test *t, unsigned long values,
+                                 unsigned long mask)
+{
+    const struct bbb_gpio_wiring *tc = t->tc;
+    unsigned int i;
+
+    for (i = 0; i < tc->num; i++) {
+        if (!(mask & BIT(i)))
+            continue;
+        if (!!(values & BIT(i)) ^ !!(tc->active_low & BIT(i)))
+            t->expect[tc->gpios[i] / 32] |= BIT(tc->gpios[i] % 32);
+        else
+            t->expect[tc->gpios[i] / 32] &= ~BIT(tc->gpios[i] % 32);
+    }
+}
+
+static void bbb_gpio_test_check(struct kunit *test, struct bbb_gpio_test *t, unsigned int n)
+{
+    unsigned int b;
+
+    for (b = 0; b < BBB_GPIO_BANKS; b++)
+        KUNIT_EXPECT_EQ_MSG(test, bbb_gpio_test_dataout(t, b), t->expect[b],
+                            "gpio%u after write %u", b, n);
+}
+
+/* Each line lands on its own bank and bit, each bank is used once */
+static void bbb_gpio_test_map(struct kunit *test)
+{
+    const struct bbb_gpio_wiring *tc = test->param_value;
+    struct bbb_gpio_test *t = bbb_gpio_test_bus(test, tc);
+    unsigned int i;
+
+    KUNIT_EXPECT_TRUE(test, t->bus.fast);
+    KUNIT_EXPECT_EQ(test, t->bus.num, tc->num);
+    KUNIT_EXPECT_EQ(test, t->bus.nbanks, tc->nbanks);
+    KUNIT_EXPECT_EQ(test, t->bus.active_low, tc->active_low);
+
+    for (i = 0; i < tc->num; i++) {
+        KUNIT_EXPECT_PTR_EQ(test, t->bus.banks[t->bus.bank[i]].regs,
+                            t->regs[tc->gpios[i] / 32]);
+        KUNIT_EXPECT_EQ(test, t->bus.bit[i], (u32)BIT(tc->gpios[i] % 32));
+    }
+}
+
+/* Full and partial writes drive exactly the masked lines, nothing else */
+static void bbb_gpio_test_write(struct kunit *test)
+{
+    const struct bbb_gpio_wiring *tc = test->param_value;
+    struct bbb_gpio_test *t = bbb_gpio_test_bus(test, tc);
+    unsigned long values, mask, all = GENMASK(tc->num - 1, 0);
+    unsigned long state = 0;
+    unsigned int i;
+
+    for (i = 0; i < BBB_GPIO_TEST_WRITES; i++) {
+        values = (i * 0x9E3779B1UL) >> 7;
+        mask = (i & 1) ? all : (i >> 1) & all;
+
+        bbb_gpio_bus_set(&t->bus, values, mask);
+        bbb_gpio_test_expect(t, values, mask);
+        state = (state & ~mask) | (values & mask);
+
+        bbb_gpio_test_check(test, t, i);
+        KUNIT_EXPECT_EQ(test, t->bus.state, state);
+        if (test->status == KUNIT_FAILURE)
+            return;
+    }
+    KUNIT_EXPECT_EQ(test, t->bus.fast_writes, (unsigned long)BBB_GPIO_TEST_WRITES);
+    KUNIT_EXPECT_EQ(test, t->bus.slow_writes, 0UL);
+}
+
+/* Lines past num and an empty mask leave every bank alone */
+static void bbb_gpio_test_mask(struct kunit *test)
+{
+    const struct bbb_gpio_wiring *tc = test->param_value;
+    struct bbb_gpio_test *t = bbb_gpio_test_bus(test, tc);
+
+    bbb_gpio_bus_set(&t->bus, ~0UL, ~GENMASK(tc->num - 1, 0));
+    bbb_gpio_test_check(test, t, 0);
+    KUNIT_EXPECT_EQ(test, t->bus.state, 0UL);
+
+    bbb_gpio_bus_set(&t->bus, ~0UL, 0);
+    bbb_gpio_test_check(test, t, 1);
+    KUNIT_EXPECT_EQ(test, t->bus.state, 0UL);
+}
+
+/* bbb_gpio_bus_set_line() asserts and deasserts one line at a time */
+static void bbb_gpio_test_set_line(struct kunit *test)
+{
+    const struct bbb_gpio_wiring *tc = test->param_value;
+    struct bbb_gpio_test *t = bbb_gpio_test_bus(test, tc);
+    unsigned int i;
+
+    for (i = 0; i < tc->num; i++) {
+        bbb_gpio_bus_set_line(&t->bus, i, 1);
+        bbb_gpio_test_expect(t, BIT(i), BIT(i));
+        bbb_gpio_test_check(test, t, 2 * i);
+        KUNIT_EXPECT_EQ(test, t->bus.state, BIT(i));
+
+        bbb_gpio_bus_set_line(&t->bus, i, 0);
+        bbb_gpio_test_expect(t, 0, BIT(i));
+        bbb_gpio_test_check(test, t, 2 * i + 1);
+        KUNIT_EXPECT_EQ(test, t->bus.state, 0UL);
+    }
+}
+
+static struct kunit_case bbb_gpio_test_cases[] = {
+    KUNIT_CASE_PARAM(bbb_gpio_test_map, bbb_gpio_wirings_gen_params),
+    KUNIT_CASE_PARAM(bbb_gpio_test_write, bbb_gpio_wirings_gen_params),
+    KUNIT_CASE_PARAM(bbb_gpio_test_mask, bbb_gpio_wirings_gen_params),
+    KUNIT_CASE_PARAM(bbb_gpio_test_set_line, bbb_gpio_wirings_gen_params),
+    {}
+};
+
+static struct kunit_suite bbb_gpio_test_suite = {
+    .name = "bbb_gpio",
+    .test_cases = bbb_gpio_test_cases,
+};
+
+kunit_test_suite(bbb_gpio_test_suite);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Anis");
+MODULE_DESCRIPTION("KUnit tests for the bbb_gpio fast path");
@@ -0,0 +1,341 @@
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/delay.h>
+#include <linux/sched.h>
+#include <linux/sched/clock.h>
+#include <linux/hrtimer.h>
+#include <linux/irqflags.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+
+#include "bbb_timing.h"
+
+#define BBB_TIMING_CAL_NS       (10 * NSEC_PER_MSEC)
+#define BBB_TIMING_SAMPLES      256
+#define BBB_TIMING_MAX_ENTRIES  32
+
+/*
+ * Short delays busy-wait on get_cycles(), which on ARM is the registered
+ * delay timer. Without one it reads 0, and local_clock() (sched_clock, the
+ * 24 MHz DMTIMER on AM335x) is used instead. The Cortex-A8 PMU cycle
+ * counter is left to perf, which owns it.
+ */
+struct bbb_timing_clock {
+    const char *source;
+    bool use_cycles;
+    u64 rate_hz;
+    u32 read_ns;
+    u32 resolution_ns;
+};
+
+struct bbb_timing_overhead {
+    char name[24];
+    const char *op;
+    u32 min_ns;
+    u32 avg_ns;
+};
+
+static struct bbb_timing_clock bbb_clock;
+static struct bbb_timing_overhead bbb_overhead[BBB_TIMING_MAX_ENTRIES];
+static unsigned int bbb_overhead_num;
+static LIST_HEAD(bbb_timing_stats);
+static DEFINE_MUTEX(bbb_timing_lock);
+static DEFINE_SPINLOCK(bbb_stat_lock);
+static struct dentry *bbb_timing_dir;
+
+cycles_t bbb_timing_cycles(void)
+{
+    return bbb_clock.use_cycles ? get_cycles() : (cycles_t)local_clock();
+}
+EXPORT_SYMBOL_GPL(bbb_timing_cycles);
+
+u64 bbb_timing_cycles_to_ns(cycles_t cycles)
+{
+    return div64_u64((u64)cycles * NSEC_PER_SEC, bbb_clock.rate_hz);
+}
+EXPORT_SYMBOL_GPL(bbb_timing_cycles_to_ns);
+
+static cycles_t bbb_timing_ns_to_cycles(u64 ns)
+{
+    return DIV64_U64_ROUND_UP(ns * bbb_clock.rate_hz, NSEC_PER_SEC);
+}
+
+/* Monotonic ns for intervals longer than the counter wraps */
+u64 bbb_timing_now(void)
+{
+    return local_clock();
+}
+EXPORT_SYMBOL_GPL(bbb_timing_now);
+
+/*
+ * Busy-waits at least @ns, minus the cost of the counter read that closes
+ * the wait. Only for the sub-microsecond to tens-of-microseconds range;
+ * anything longer should sleep.
+ */
+void bbb_ndelay(u32 ns)
+{
+    cycles_t start = bbb_timing_cycles();
+    cycles_t wait;
+
+    if (ns <= bbb_clock.read_ns)
+        return;
+
+    wait = bbb_timing_ns_to_cycles(ns - bbb_clock.read_ns);
+    while ((cycles_t)(bbb_timing_cycles() - start) < wait)
+        cpu_relax();
+}
+EXPORT_SYMBOL_GPL(bbb_ndelay);
+
+/*
+ * Sleeps to an absolute deadline, so periodic loops do not drift by their
+ * own run time the way back-to-back msleep() calls do. Returns early on
+ * kthread_stop() or a signal.
+ */
+void bbb_sleep_until(ktime_t deadline)
+{
+    set_current_state(TASK_INTERRUPTIBLE);
+    schedule_hrtimeout_range(&deadline, 50 * NSEC_PER_USEC, HRTIMER_MODE_ABS);
+}
+EXPORT_SYMBOL_GPL(bbb_sleep_until);
+
+void bbb_timing_stat_add(struct bbb_timing_stat *st, const char *name, u64 requested_ns)
+{
+    st->name = name;
+    st->requested_ns = requested_ns;
+    st->count = 0;
+    st->sum_ns = 0;
+    st->min_ns = U64_MAX;
+    st->max_ns = 0;
+
+    mutex_lock(&bbb_timing_lock);
+    list_add_tail(&st->node, &bbb_timing_stats);
+    mutex_unlock(&bbb_timing_lock);
+}
+EXPORT_SYMBOL_GPL(bbb_timing_stat_add);
+
+void bbb_timing_stat_del(struct bbb_timing_stat *st)
+{
+    mutex_lock(&bbb_timing_lock);
+    list_del(&st->node);
+    mutex_unlock(&bbb_timing_lock);
+}
+EXPORT_SYMBOL_GPL(bbb_timing_stat_del);
+
+void bbb_timing_stat_record(struct bbb_timing_stat *st, u64 achieved_ns)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&bbb_stat_lock, flags);
+    st->count++;
+    st->sum_ns += achieved_ns;
+    st->min_ns = min(st->min_ns, achieved_ns);
+    st->max_ns = max(st->max_ns, achieved_ns);
+    spin_unlock_irqrestore(&bbb_stat_lock, flags);
+}
+EXPORT_SYMBOL_GPL(bbb_timing_stat_record);
+
+static void bbb_timing_overhead_add(const char *name, const char *op, u64 min_ns, u64 sum_ns)
+{
+    struct bbb_timing_overhead *o;
+    unsigned int i;
+
+    mutex_lock(&bbb_timing_lock);
+    for (i = 0; i < bbb_overhead_num; i++) {
+        if (!strcmp(bbb_overhead[i].name, name) && !strcmp(bbb_overhead[i].op, op))
+            break;
+    }
+    if (i < BBB_TIMING_MAX_ENTRIES) {
+        o = &bbb_overhead[i];
+        strscpy(o->name, name, sizeof(o->name));
+        o->op = op;
+        o->min_ns = min_ns;
+        o->avg_ns = div_u64(sum_ns, BBB_TIMING_SAMPLES);
+        bbb_overhead_num = max(bbb_overhead_num, i + 1);
+    }
+    mutex_unlock(&bbb_timing_lock);
+}
+
+enum { OP_LINE, OP_BUS, OP_GPIOD, OP_NUM };
+
+static const char * const bbb_op_names[OP_NUM] = {
+    [OP_LINE] = "bus_set_line",
+    [OP_BUS] = "bus_set_all",
+    [OP_GPIOD] = "gpiod_set_value",
+};
+
+/*
+ * Times the write paths of @bus with interrupts off. Every write stores the
+ * value the lines already have, so nothing changes on the pins and it is
+ * safe on a live bus (an LCD does not latch while EN stays put).
+ */
+void bbb_timing_measure_bus(struct bbb_gpio_bus *bus, const char *name)
+{
+    u64 min_ns[OP_NUM], sum_ns[OP_NUM], ns;
+    unsigned long all = GENMASK(bus->num - 1, 0);
+    unsigned long flags;
+    cycles_t t0;
+    int op, i;
+
+    for (op = 0; op < OP_NUM; op++) {
+        min_ns[op] = U64_MAX;
+        sum_ns[op] = 0;
+        if (op == OP_GPIOD && !bus->descs[0])
+            continue;
+
+        for (i = 0; i < BBB_TIMING_SAMPLES; i++) {
+            local_irq_save(flags);
+            t0 = bbb_timing_cycles();
+            if (op == OP_LINE)
+                bbb_gpio_bus_set_line(bus, 0, bus->state & BIT(0));
+            else if (op == OP_BUS)
+                bbb_gpio_bus_set(bus, bus->state, all);
+            else
+                gpiod_set_value(bus->descs[0], bus->state & BIT(0));
+            ns = bbb_timing_cycles_to_ns(bbb_timing_cycles() - t0);
+            local_irq_restore(flags);
+
+            ns = (ns > bbb_clock.read_ns) ? ns - bbb_clock.read_ns : 0;
+            min_ns[op] = min(min_ns[op], ns);
+            sum_ns[op] += ns;
+        }
+        bbb_timing_overhead_add(name, bbb_op_names[op], min_ns[op], sum_ns[op]);
+    }
+}
+EXPORT_SYMBOL_GPL(bbb_timing_measure_bus);
+
+/*
+ * Drives @line high for at least st->requested_ns and back low. The wait
+ * starts once the rising store has been issued and the falling store is
+ * only issued after it, so the line is never high for less than asked
+ * (e.g. the HD44780's PWEH). That interval is recorded in @st and
+ * returned; the pin sees it plus the difference in store latency.
+ */
+u64 bbb_gpio_pulse(struct bbb_gpio_bus *bus, unsigned int line, struct bbb_timing_stat *st)
+{
+    cycles_t t0, t1, wait = bbb_timing_ns_to_cycles(st->requested_ns);
+    unsigned long flags;
+    u64 ns;
+
+    local_irq_save(flags);
+    bbb_gpio_bus_set_line(bus, line, 1);
+    t0 = bbb_timing_cycles();
+    while ((cycles_t)((t1 = bbb_timing_cycles()) - t0) < wait)
+        cpu_relax();
+    bbb_gpio_bus_set_line(bus, line, 0);
+    local_irq_restore(flags);
+    ns = bbb_timing_cycles_to_ns(t1 - t0);
+
+    bbb_timing_stat_record(st, ns);
+    return ns;
+}
+EXPORT_SYMBOL_GPL(bbb_gpio_pulse);
+
+/* Counter rate against ktime, cost of one read and smallest visible step */
+static void bbb_timing_calibrate(void)
+{
+    struct bbb_timing_clock *c = &bbb_clock;
+    cycles_t c0, c1, step = 0;
+    unsigned long flags;
+    u64 k0, k1;
+    int i;
+
+    c->use_cycles = get_cycles() != 0;
+    c->source = c->use_cycles ? "get_cycles" : "sched_clock";
+    c->rate_hz = NSEC_PER_SEC;
+
+    if (c->use_cycles) {
+        k0 = ktime_get_ns();
+        c0 = get_cycles();
+        mdelay(BBB_TIMING_CAL_NS / NSEC_PER_MSEC);
+        k1 = ktime_get_ns();
+        c1 = get_cycles();
+        c->rate_hz = div64_u64((u64)(cycles_t)(c1 - c0) * NSEC_PER_SEC, k1 - k0);
+    }
+
+    local_irq_save(flags);
+    c0 = bbb_timing_cycles();
+    for (i = 0; i < BBB_TIMING_SAMPLES; i++)
+        bbb_timing_cycles();
+    c1 = bbb_timing_cycles();
+    local_irq_restore(flags);
+    c->read_ns = div_u64(bbb_timing_cycles_to_ns(c1 - c0), BBB_TIMING_SAMPLES + 1);
+
+    for (i = 0; i < BBB_TIMING_SAMPLES; i++) {
+        c0 = bbb_timing_cycles();
+        while ((c1 = bbb_timing_cycles()) == c0)
+            cpu_relax();
+        if (!step || (cycles_t)(c1 - c0) < step)
+            step = c1 - c0;
+    }
+    c->resolution_ns = bbb_timing_cycles_to_ns(step);
+}
+
+static int clock_show(struct seq_file *s, void *unused)
+{
+    seq_printf(s, "source        %s\n", bbb_clock.source);
+    seq_printf(s, "rate_hz       %llu\n", bbb_clock.rate_hz);
+    seq_printf(s, "read_ns       %u\n", bbb_clock.read_ns);
+    seq_printf(s, "resolution_ns %u\n", bbb_clock.resolution_ns);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(clock);
+
+static int overhead_show(struct seq_file *s, void *unused)
+{
+    unsigned int i;
+
+    seq_puts(s, "bus                      op               min_ns   avg_ns\n");
+    mutex_lock(&bbb_timing_lock);
+    for (i = 0; i < bbb_overhead_num; i++)
+        seq_printf(s, "%-24s %-16s %-8u %u\n", bbb_overhead[i].name, bbb_overhead[i].op,
+                   bbb_overhead[i].min_ns, bbb_overhead[i].avg_ns);
+    mutex_unlock(&bbb_timing_lock);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(overhead);
+
+static int pulses_show(struct seq_file *s, void *unused)
+{
+    struct bbb_timing_stat *st;
+
+    seq_puts(s, "name                 requested_ns count      min_ns       avg_ns       max_ns\n");
+    mutex_lock(&bbb_timing_lock);
+    list_for_each_entry(st, &bbb_timing_stats, node) {
+        seq_printf(s, "%-20s %-12llu %-10llu %-12llu %-12llu %llu\n", st->name,
+                   st->requested_ns, st->count, st->count ? st->min_ns : 0,
+                   st->count ? div64_u64(st->sum_ns, st->count) : 0, st->max_ns);
+    }
+    mutex_unlock(&bbb_timing_lock);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(pulses);
+
+static int __init bbb_timing_init(void)
+{
+    bbb_timing_calibrate();
+
+    bbb_timing_dir = debugfs_create_dir("bbb_timing", NULL);
+    debugfs_create_file("clock", 0444, bbb_timing_dir, NULL, &clock_fops);
+    debugfs_create_file("overhead", 0444, bbb_timing_dir, NULL, &overhead_fops);
+    debugfs_create_file("pulses", 0444, bbb_timing_dir, NULL, &pulses_fops);
+
+    pr_info("bbb_timing: %s at %llu Hz, read %u ns, resolution %u ns\n", bbb_clock.source,
+            bbb_clock.rate_hz, bbb_clock.read_ns, bbb_clock.resolution_ns);
+    return 0;
+}
+
+static void __exit bbb_timing_exit(void)
+{
+    debugfs_remove_recursive(bbb_timing_dir);
+    pr_info("bbb_timing unloaded\n");
+}
+
+module_init(bbb_timing_init);
+module_exit(bbb_timing_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Anis");
+MODULE_DESCRIPTION("Calibrated short delays and pulse timing for bit-banged GPIO");
@@ -0,0 +1,35 @@
+#ifndef BBB_TIMING_H
+#define BBB_TIMING_H
+
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/ktime.h>
+#include <linux/timex.h>
+
+#include "bbb_gpio.h"
+
+/* Requested vs achieved duration of one kind of pulse, listed in debugfs */
+struct bbb_timing_stat {
+    const char *name;
+    u64 requested_ns;
+    u64 count;
+    u64 sum_ns;
+    u64 min_ns;
+    u64 max_ns;
+    struct list_head node;
+};
+
+cycles_t bbb_timing_cycles(void);
+u64 bbb_timing_cycles_to_ns(cycles_t cycles);
+u64 bbb_timing_now(void);
+void bbb_ndelay(u32 ns);
+void bbb_sleep_until(ktime_t deadline);
+
+void bbb_timing_stat_add(struct bbb_timing_stat *st, const char *name, u64 requested_ns);
+void bbb_timing_stat_del(struct bbb_timing_stat *st);
+void bbb_timing_stat_record(struct bbb_timing_stat *st, u64 achieved_ns);
+
+void bbb_timing_measure_bus(struct bbb_gpio_bus *bus, const char *name);
+u64 bbb_gpio_pulse(struct bbb_gpio_bus *bus, unsigned int line, struct bbb_timing_stat *st);
+
+#endif